@@ -0,0 +1,187 @@
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include "../DesignPatternsCpp/Solid.cpp"
+#include "../DesignPatternsCpp/Builder.cpp"
+#include "../CPlusPlus/LetterFrequencyBenchmark.h"
+#include "../CPlusPlus/SerializationBenchmark.h"
+#include "../CPlusPlus/InlineFunctionBenchmark.h"
+#include "../CPlusPlus/SpatialIndexBenchmark.h"
+
+using namespace std;
+
+// every allocation in the process goes through here so the benchmarks can report allocations per operation
+void* operator new(size_t size)
+{
+	Benchmark::allocation_count.fetch_add(1, memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// std::pmr::new_delete_resource may ask for aligned memory
+void* operator new(size_t size, align_val_t alignment)
+{
+	Benchmark::allocation_count.fetch_add(1, memory_order_relaxed);
+	const auto align = static_cast<size_t>(alignment);
+	size = (max<size_t>(size, 1) + align - 1) / align * align; // aligned_alloc wants a multiple of the alignment
+#ifdef _MSC_VER
+	if (void* p = _aligned_malloc(size, align))
+#else
+	if (void* p = aligned_alloc(align, size))
+#endif
+		return p;
+	throw bad_alloc();
+}
+
+#ifdef _MSC_VER
+void operator delete(void* p, align_val_t) noexcept { _aligned_free(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { _aligned_free(p); }
+#else
+void operator delete(void* p, align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, align_val_t) noexcept { free(p); }
+#endif
+
+// set by the benchmarks that also check their results (stress tests), the process then exits with 1
+bool check_failed = false;
+
+// --scale, the benchmarks whose size is not the amount of work scale the amount of work themselves
+double scale = 1.0;
+
+struct Entry
+{
+	string name;
+	vector<size_t> sizes; // every benchmark runs once per size
+	function<void(size_t size, unsigned seed)> run;
+	bool scale_sizes = true; // false when a size is a parameter (a string length) and not the amount of work
+};
+
+vector<Entry> all_benchmarks()
+{
+	return {
+		{ "html_builder", { 100, 10'000 }, [](size_t n, unsigned) { html_builder_benchmark(n); } },
+		{ "html_builder_memory", { 1'000 }, [](size_t n, unsigned) { html_builder_memory_benchmark(n); } },
+		{ "tags", { 100'000 }, [](size_t n, unsigned) { tag_benchmark(n); } },
+		{ "filters", { 1'000, 100'000 }, [](size_t n, unsigned seed) { Solid::OpenClosePrinciple{}.open_closed_principle_benchmark(n, seed); } },
+		{ "filters_memory", { 1'000 }, [](size_t n, unsigned) { Solid::OpenClosePrinciple{}.open_closed_principle_memory_benchmark(n); } },
+		{ "aggregation", { 1'000'000 }, [](size_t n, unsigned seed) { Solid::OpenClosePrinciple{}.open_closed_principle_aggregation_benchmark(n, seed); } },
+		{ "relationships", { 1'000, 10'000, 100'000 }, [](size_t n, unsigned seed) { Solid::DependencyInversionPrinciple{}.dependency_inversion_principle_benchmark(n, seed); } },
+		{ "relationships_memory", { 1'000 }, [](size_t n, unsigned) { Solid::DependencyInversionPrinciple{}.dependency_inversion_principle_memory_benchmark(n); } },
+		{ "relationships_concurrent", { 10'000 }, [](size_t n, unsigned seed) { Solid::DependencyInversionPrinciple{}.concurrent_relationships_benchmark(n, 200'000, seed); } },
+		{ "relationships_stress", { 20'000 }, [](size_t n, unsigned)
+		{
+			if (!Solid::DependencyInversionPrinciple{}.concurrent_relationships_stress(1000, n))
+				check_failed = true;
+		} },
+		{ "letter_frequency", { 8, 40, 160, 4096 }, [](size_t n, unsigned seed)
+		{
+			// n is the length of the strings, only the number of pairs is scaled
+			letter_frequency_benchmark(n, max<size_t>(1, static_cast<size_t>(16'000'000 / (n + 8) * scale)), seed);
+		}, false },
+		{ "shapes", { 1'000'000, 4'000'000 }, [](size_t n, unsigned) { Solid::LiskovsSubstitutionPrinciple{}.liskovs_substitution_principle_benchmark(n); } },
+		{ "pipeline", { 2'000 }, [](size_t n, unsigned) { Solid::InterfaceSegregationPrinciple{}.interface_segregation_principle_benchmark(n); } },
+		{ "spooler", { 20'000 }, [](size_t n, unsigned) { Solid::InterfaceSegregationPrinciple{}.print_spooler_benchmark(n); } },
+		{ "serialization", { 1'000'000 }, [](size_t n, unsigned) { SerializationBenchmark::serialization_benchmark(n); } },
+		{ "spatial_index", { 1'000'000, 10'000'000, 100'000'000 },
+			[](size_t n, unsigned seed) { SpatialIndexBenchmark::spatial_index_benchmark(n, 10'000, seed); } },
+		{ "inline_function", { 50'000'000 }, [](size_t n, unsigned) { InlineFunctionBenchmark::inline_function_benchmark(n, n / 10); } },
+	};
+}
+
+void print_usage()
+{
+	cout << "usage: benchmarks [--list] [--filter=TEXT] [--scale=FACTOR] [--seed=N] [--json=FILE] [--trace=FILE]\n"
+		<< "  --list          print the names of the benchmarks and exit\n"
+		<< "  --filter=TEXT   run only the benchmarks whose name contains TEXT\n"
+		<< "  --scale=FACTOR  multiply the amount of work by FACTOR, for example 0.01 for a quick run\n"
+		<< "  --seed=N        seed of the synthetic data generators (42 by default)\n"
+		<< "  --json=FILE     save all the results as JSON so runs can be compared\n"
+		<< "  --trace=FILE    save the instrumentation spans in the Chrome trace format\n"
+		<< "                  (needs a build with -DENABLE_INSTRUMENTATION=ON)" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	string filter, json_path, trace_path;
+	unsigned seed = 42;
+	bool list = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string argument = argv[i];
+		auto value = [&argument](const string& option) { return argument.substr(option.size()); };
+
+		if (argument == "--list")
+			list = true;
+		else if (argument.rfind("--filter=", 0) == 0)
+			filter = value("--filter=");
+		else if (argument.rfind("--scale=", 0) == 0)
+			scale = stod(value("--scale="));
+		else if (argument.rfind("--seed=", 0) == 0)
+			seed = static_cast<unsigned>(stoul(value("--seed=")));
+		else if (argument.rfind("--json=", 0) == 0)
+			json_path = value("--json=");
+		else if (argument.rfind("--trace=", 0) == 0)
+			trace_path = value("--trace=");
+		else
+		{
+			print_usage();
+			return argument == "--help" ? 0 : 1;
+		}
+	}
+
+	if (!Benchmark::PerfCounters::instance().available())
+		cout << "hardware counters are not available (perf_event_open failed), only time and allocations are reported" << endl;
+
+	for (const auto& benchmark : all_benchmarks())
+	{
+		if (benchmark.name.find(filter) == string::npos)
+			continue;
+		if (list)
+		{
+			cout << benchmark.name << endl;
+			continue;
+		}
+
+		for (const size_t size : benchmark.sizes)
+		{
+			const size_t scaled = benchmark.scale_sizes ? max<size_t>(1, static_cast<size_t>(size * scale)) : size;
+			Benchmark::context() = benchmark.name + "/" + to_string(scaled);
+			cout << "=== " << Benchmark::context() << " ===" << endl;
+			benchmark.run(scaled, seed);
+		}
+	}
+
+#ifdef ENABLE_INSTRUMENTATION
+	if (!list)
+	{
+		cout << "=== instrumentation ===" << endl;
+		Instrumentation::print_totals();
+	}
+	if (!trace_path.empty() && !Instrumentation::write_chrome_trace(trace_path))
+	{
+		cerr << "cannot write " << trace_path << endl;
+		return 1;
+	}
+#else
+	if (!trace_path.empty())
+		cerr << "instrumentation is compiled out, rebuild with -DENABLE_INSTRUMENTATION=ON to get a trace" << endl;
+#endif
+
+	if (!json_path.empty() && !Benchmark::write_json(json_path))
+	{
+		cerr << "cannot write " << json_path << endl;
+		return 1;
+	}
+	if (check_failed)
+	{
+		cerr << "some of the checks failed, see the output above" << endl;
+		return 1;
+	}
+	return 0;
+}
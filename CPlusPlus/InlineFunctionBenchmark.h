@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <vector>
+#include "../Common/Benchmark.h"
+#include "../Common/InlineFunction.h"
+
+namespace InlineFunctionBenchmark
+{
+	inline int add_one(int x) { return x + 1; }
+
+	// the loops take the callable as a parameter, the way a filter or a render loop would
+	template <typename Callable> int call_many_times(const Callable& f, const size_t calls)
+	{
+		int value = 0;
+		for (size_t i = 0; i < calls; i++)
+			value = f(value);
+		return value;
+	}
+
+	inline int call_many_times_ref(function_ref<int(int)> f, const size_t calls)
+	{
+		int value = 0;
+		for (size_t i = 0; i < calls; i++)
+			value = f(value);
+		return value;
+	}
+
+	// call overhead for the same function behind different wrappers
+	// and construction cost of a wrapper around a lambda with captures too big for std::function's small buffer
+	inline void inline_function_benchmark(const size_t calls = 50'000'000, const size_t constructions = 5'000'000)
+	{
+		int result = 0;
+		int step = 1;
+		auto lambda = [&step](int x) { return x + step; };
+
+		int (*pointer)(int) = &add_one;
+		Benchmark::do_not_optimize(pointer);
+		const auto raw = Benchmark::measure([&] { result = call_many_times(pointer, calls); });
+		Benchmark::report("call through a function pointer", raw, calls);
+
+		const std::function<int(int)> standard = lambda;
+		const auto std_call = Benchmark::measure([&] { result = call_many_times(standard, calls); });
+		Benchmark::report("call through std::function", std_call, calls);
+
+		const inline_function<int(int)> inlined = lambda;
+		const auto inline_call = Benchmark::measure([&] { result = call_many_times(inlined, calls); });
+		Benchmark::report("call through inline_function", inline_call, calls);
+
+		const auto ref_call = Benchmark::measure([&] { result = call_many_times_ref(lambda, calls); });
+		Benchmark::report("call through function_ref", ref_call, calls);
+		Benchmark::do_not_optimize(result);
+
+		// 48 bytes of captures
+		std::array<int, 12> table{};
+		auto big_lambda = [table](int x) { return x + table[x & 7]; };
+
+		const auto std_construct = Benchmark::measure([&]
+		{
+			for (size_t i = 0; i < constructions; i++)
+			{
+				std::function<int(int)> f = big_lambda;
+				Benchmark::do_not_optimize(f);
+			}
+		});
+		Benchmark::report("construct std::function (48 bytes of captures)", std_construct, constructions);
+
+		const auto inline_construct = Benchmark::measure([&]
+		{
+			for (size_t i = 0; i < constructions; i++)
+			{
+				inline_function<int(int), 64> f = big_lambda;
+				Benchmark::do_not_optimize(f);
+			}
+		});
+		Benchmark::report("construct inline_function (48 bytes of captures)", inline_construct, constructions);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../Common/Benchmark.h"
+#include "LetterFrequency.h"
+
+// random lowercase strings, the same seed gives the same strings every time
+inline std::vector<std::pair<std::string, std::string>> make_letter_pairs(const size_t count, const size_t length, const unsigned seed = 42)
+{
+	std::mt19937 random{ seed };
+	std::uniform_int_distribution<int> letter{ 'a', 'z' };
+
+	std::vector<std::pair<std::string, std::string>> pairs(count);
+	for (auto& [a, b] : pairs)
+	{
+		a.resize(length);
+		b.resize(length);
+		for (auto& c : a)
+			c = static_cast<char>(letter(random));
+		for (auto& c : b)
+			c = static_cast<char>(letter(random));
+	}
+	return pairs;
+}
+
+// scalar loop versus the library versions
+inline void letter_frequency_benchmark(const size_t length, const size_t pair_count, const unsigned seed = 42)
+{
+	const auto pairs = make_letter_pairs(pair_count, length, seed);
+	const std::string suffix = ", " + std::to_string(length) + " characters";
+	std::vector<int> results(pairs.size());
+
+	const auto scalar = Benchmark::measure([&]
+	{
+		for (size_t i = 0; i < pairs.size(); i++)
+			results[i] = LetterFrequency::anagram_distance_scalar(pairs[i].first, pairs[i].second);
+	});
+	Benchmark::do_not_optimize(results);
+	Benchmark::report("scalar" + suffix, scalar, pair_count);
+
+	const auto single = Benchmark::measure([&]
+	{
+		for (size_t i = 0; i < pairs.size(); i++)
+			results[i] = LetterFrequency::anagram_distance(pairs[i].first, pairs[i].second);
+	});
+	Benchmark::do_not_optimize(results);
+	Benchmark::report("anagram_distance" + suffix, single, pair_count);
+
+	const auto batch = Benchmark::measure([&] { LetterFrequency::anagram_distances(pairs, results); });
+	Benchmark::do_not_optimize(results);
+	Benchmark::report("anagram_distances (all threads)" + suffix, batch, pair_count);
+}
+
+// short, medium and long strings, one length in every range of anagram_distance
+inline void letter_frequency_benchmark()
+{
+	letter_frequency_benchmark(8, 2'000'000);
+	letter_frequency_benchmark(40, 1'000'000);
+	letter_frequency_benchmark(160, 200'000);
+	letter_frequency_benchmark(4096, 20'000);
+}
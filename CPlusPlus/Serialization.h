@@ -0,0 +1,184 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// === binary serialization of trivially copyable types ===
+// reading the bytes of an int through a union (or a reinterpret_cast pointer) is undefined behaviour in C++
+// the only blessed ways to look at the bytes of an object are memcpy and (since C++20) std::bit_cast
+// compilers understand memcpy of a few bytes very well and turn it into a single load or store
+//
+// the order of bytes in memory (endianness) differs between platforms - x86 is little endian,
+// network protocols are usually big endian - so the wire format has its endianness written down
+// and the bytes are swapped only when it differs from the machine we run on
+//
+// the wire layout is computed at compile time from the list of fields, fields are packed without padding:
+//
+//	struct Point { float x, y; };
+//	template <> struct Serialization::Fields<Point>
+//	{
+//		static constexpr auto list = std::make_tuple(&Point::x, &Point::y);
+//	};
+namespace Serialization
+{
+	enum class Endian
+	{
+		little,
+		big,
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+		native = little
+#else
+		native = big
+#endif
+	};
+
+	inline uint16_t byte_swap(const uint16_t value) { return static_cast<uint16_t>((value << 8) | (value >> 8)); }
+
+	inline uint32_t byte_swap(const uint32_t value)
+	{
+#if defined(_MSC_VER)
+		return _byteswap_ulong(value);
+#else
+		return __builtin_bswap32(value);
+#endif
+	}
+
+	inline uint64_t byte_swap(const uint64_t value)
+	{
+#if defined(_MSC_VER)
+		return _byteswap_uint64(value);
+#else
+		return __builtin_bswap64(value);
+#endif
+	}
+
+	namespace Detail
+	{
+		template <size_t Size> struct UnsignedOfSize;
+		template <> struct UnsignedOfSize<1> { using type = uint8_t; };
+		template <> struct UnsignedOfSize<2> { using type = uint16_t; };
+		template <> struct UnsignedOfSize<4> { using type = uint32_t; };
+		template <> struct UnsignedOfSize<8> { using type = uint64_t; };
+
+		template <typename MemberPointer> struct MemberType;
+		template <typename Class, typename Type> struct MemberType<Type Class::*> { using type = Type; };
+	}
+
+	// stores a field at the given address in the requested endianness
+	template <Endian E, typename Field> void store(const Field& value, unsigned char* out)
+	{
+		static_assert(std::is_arithmetic_v<Field> || std::is_enum_v<Field>, "only numbers and enums can be stored");
+
+		using Bits = typename Detail::UnsignedOfSize<sizeof(Field)>::type;
+		Bits bits;
+		std::memcpy(&bits, &value, sizeof(Field));
+		if constexpr (E != Endian::native && sizeof(Field) > 1)
+			bits = byte_swap(bits);
+		std::memcpy(out, &bits, sizeof(Field));
+	}
+
+	template <Endian E, typename Field> Field load(const unsigned char* in)
+	{
+		static_assert(std::is_arithmetic_v<Field> || std::is_enum_v<Field>, "only numbers and enums can be loaded");
+
+		using Bits = typename Detail::UnsignedOfSize<sizeof(Field)>::type;
+		Bits bits;
+		std::memcpy(&bits, in, sizeof(Field));
+		if constexpr (E != Endian::native && sizeof(Field) > 1)
+			bits = byte_swap(bits);
+
+		Field value;
+		std::memcpy(&value, &bits, sizeof(Field));
+		return value;
+	}
+
+	// has to be specialized for every serialized type, see the example at the top
+	template <typename T> struct Fields;
+
+	template <typename T> struct Layout
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be serialized");
+
+		using List = std::decay_t<decltype(Fields<T>::list)>;
+		static constexpr size_t field_count = std::tuple_size_v<List>;
+
+		template <size_t I> using FieldType = typename Detail::MemberType<std::tuple_element_t<I, List>>::type;
+
+	private:
+		template <size_t... I> static constexpr std::array<size_t, field_count + 1> compute_offsets(std::index_sequence<I...>)
+		{
+			const size_t sizes[] = { sizeof(FieldType<I>)..., 0 };
+			std::array<size_t, field_count + 1> result{};
+			for (size_t i = 0; i < field_count; i++)
+				result[i + 1] = result[i] + sizes[i];
+			return result;
+		}
+
+	public:
+		// offsets[i] is where the i-th field starts, the last element is the size of the whole record
+		static constexpr std::array<size_t, field_count + 1> offsets = compute_offsets(std::make_index_sequence<field_count>{});
+		static constexpr size_t size = offsets[field_count];
+	};
+
+	template <Endian E, typename T> void write(const T& record, unsigned char* out)
+	{
+		std::apply([&](auto... members)
+		{
+			size_t i = 0;
+			((store<E>(record.*members, out + Layout<T>::offsets[i++])), ...);
+		}, Fields<T>::list);
+	}
+
+	template <Endian E, typename T> T read(const unsigned char* in)
+	{
+		T record{};
+		std::apply([&](auto... members)
+		{
+			size_t i = 0;
+			((record.*members = load<E, std::remove_reference_t<decltype(record.*members)>>(in + Layout<T>::offsets[i++])), ...);
+		}, Fields<T>::list);
+		return record;
+	}
+
+	// appends the records to the buffer, the buffer grows once for all of them
+	template <Endian E = Endian::little, typename T> void write_all(const std::vector<T>& records, std::vector<unsigned char>& buffer)
+	{
+		const size_t start = buffer.size();
+		buffer.resize(start + records.size() * Layout<T>::size);
+
+		unsigned char* out = buffer.data() + start;
+		for (const auto& record : records)
+		{
+			write<E>(record, out);
+			out += Layout<T>::size;
+		}
+	}
+
+	// looks at an array of records lying in memory (for example a memory mapped file) without copying it anywhere
+	// a single field of a single record can be read without decoding the rest
+	template <typename T, Endian E = Endian::little> class RecordView
+	{
+		const unsigned char* data;
+		size_t count;
+
+	public:
+		RecordView(const unsigned char* data, const size_t byte_count)
+			: data{ data }, count{ byte_count / Layout<T>::size } { }
+
+		size_t size() const { return count; }
+
+		T operator[](const size_t index) const { return read<E, T>(data + index * Layout<T>::size); }
+
+		// the I-th field of the record at the given index
+		template <size_t I> typename Layout<T>::template FieldType<I> field(const size_t index) const
+		{
+			return load<E, typename Layout<T>::template FieldType<I>>(data + index * Layout<T>::size + Layout<T>::offsets[I]);
+		}
+	};
+}
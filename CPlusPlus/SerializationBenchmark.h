@@ -0,0 +1,103 @@
+#pragma once
+#include <random>
+#include <sstream>
+#include <vector>
+#include "../Common/Benchmark.h"
+#include "Serialization.h"
+
+namespace SerializationBenchmark
+{
+	struct Point
+	{
+		float x, y;
+	};
+
+	struct Reading
+	{
+		uint32_t sensor;
+		double value;
+		uint16_t flags;
+	};
+}
+
+template <> struct Serialization::Fields<SerializationBenchmark::Point>
+{
+	static constexpr auto list = std::make_tuple(&SerializationBenchmark::Point::x, &SerializationBenchmark::Point::y);
+};
+
+template <> struct Serialization::Fields<SerializationBenchmark::Reading>
+{
+	static constexpr auto list = std::make_tuple(&SerializationBenchmark::Reading::sensor,
+		&SerializationBenchmark::Reading::value, &SerializationBenchmark::Reading::flags);
+};
+
+namespace SerializationBenchmark
+{
+	// 4 + 8 + 2 bytes on the wire while sizeof(Reading) is 24 because of the padding
+	static_assert(Serialization::Layout<Reading>::size == 14);
+
+	inline std::vector<Reading> make_readings(const size_t count, const unsigned seed = 42)
+	{
+		std::mt19937 random{ seed };
+		std::vector<Reading> readings(count);
+		for (auto& r : readings)
+			r = { static_cast<uint32_t>(random()), random() / 1000.0, static_cast<uint16_t>(random()) };
+		return readings;
+	}
+
+	// binary records in both byte orders versus the same records written as text with iostreams
+	inline void serialization_benchmark(const size_t record_count = 1'000'000)
+	{
+		using namespace Serialization;
+		const auto readings = make_readings(record_count);
+		std::vector<unsigned char> buffer;
+		double sum = 0;
+
+		const auto write_little = Benchmark::measure([&] { buffer.clear(); write_all<Endian::little>(readings, buffer); });
+		Benchmark::report("write_all little endian", write_little, record_count);
+
+		const auto read_little = Benchmark::measure([&]
+		{
+			RecordView<Reading, Endian::little> view{ buffer.data(), buffer.size() };
+			sum = 0;
+			for (size_t i = 0; i < view.size(); i++)
+				sum += view.field<1>(i);
+		});
+		Benchmark::do_not_optimize(sum);
+		Benchmark::report("RecordView little endian, one field", read_little, record_count);
+
+		const auto write_big = Benchmark::measure([&] { buffer.clear(); write_all<Endian::big>(readings, buffer); });
+		Benchmark::report("write_all big endian", write_big, record_count);
+
+		const auto read_big = Benchmark::measure([&]
+		{
+			RecordView<Reading, Endian::big> view{ buffer.data(), buffer.size() };
+			sum = 0;
+			for (size_t i = 0; i < view.size(); i++)
+				sum += view[i].value;
+		});
+		Benchmark::do_not_optimize(sum);
+		Benchmark::report("RecordView big endian, whole record", read_big, record_count);
+
+		std::string text;
+		const auto write_text = Benchmark::measure([&]
+		{
+			std::ostringstream out;
+			for (const auto& r : readings)
+				out << r.sensor << ' ' << r.value << ' ' << r.flags << '\n';
+			text = out.str();
+		}, 1);
+		Benchmark::report("iostream write", write_text, record_count);
+
+		const auto read_text = Benchmark::measure([&]
+		{
+			std::istringstream in{ text };
+			Reading r{};
+			sum = 0;
+			while (in >> r.sensor >> r.value >> r.flags)
+				sum += r.value;
+		}, 1);
+		Benchmark::do_not_optimize(sum);
+		Benchmark::report("iostream read", read_text, record_count);
+	}
+}
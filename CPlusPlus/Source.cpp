@@ -47,6 +47,14 @@
 #include <iostream>
 #include <array>
 #include <functional>
+#include "LetterFrequency.h"
+#include "LetterFrequencyBenchmark.h"
+#include "Serialization.h"
+#include "SerializationBenchmark.h"
+#include "../Common/InlineFunction.h"
+#include "InlineFunctionBenchmark.h"
+#include "SpatialIndex.h"
+#include "SpatialIndexBenchmark.h"
 using namespace std;
 
 // preprocessor
@@ -70,9 +78,6 @@ int main()
 	std::cout << size_of_a << endl;
 	std::cout << size_of_b << endl;
 
-	int how_many_chars_a[26];
-	int how_many_chars_b[26];
-
 	std::cout << A[0] << endl;
 	std::cout << A[1] << endl;
 	std::cout << A[2] << endl;
@@ -85,24 +90,10 @@ int main()
 	std::cout << (int)'b' << endl;
 	std::cout << (int)'z' << endl;
 
-	int letter = 0;
-	for (int i = 0; i < size_of_a; i++)
-	{
-		// a - 97
-		// z - 122
-		letter = A[i] - 97;
-		how_many_chars_a[letter]++;
-
-		letter = B[i] - 97;
-		how_many_chars_b[letter]++;
-	}
-
-	int totalResult = 0;
-	for (int i = 0; i < 26; i++)
-	{
-		// first we have
-		totalResult += abs(how_many_chars_a[i] - how_many_chars_b[i]);
-	}
+	// every character of A counts up, every character of B counts down
+	// whatever is left in the counters has to be deleted (see LetterFrequency.h)
+	int totalResult = LetterFrequency::anagram_distance(A, B);
+	//letter_frequency_benchmark();
 
 	return totalResult;
 
@@ -238,6 +229,13 @@ int main()
 	// In C# everything is just captured by ref or val depends on data type
 	auto f_lambda_with_capture = [function_result](int x) { return function_result + x; };
 
+	// std::function may allocate memory for the captures and the call cannot be inlined
+	// on hot paths use one of these instead (see InlineFunction.h)
+	inline_function<int(int)> f_inline = f_lambda_with_capture; // captures live inside the object, never allocates
+	function_ref<int(int)> f_ref = f_lambda_with_capture; // does not own the lambda, just refers to it
+	function_result = f_inline(f_ref(function_result));
+	//InlineFunctionBenchmark::inline_function_benchmark();
+
 	// possible capture values
 	// [=] - capture everything by value
 	// [&] - capture everything by reference
@@ -264,6 +262,12 @@ int main()
 	FourBytes fb;
 	fb.int_value = 123;
 	fb.bytes[2] = 4;
+	// careful: reading a different member than the one written last is undefined behaviour in C++
+	// and the result depends on the endianness of the machine anyway
+	// the portable way is memcpy - see Serialization.h
+	unsigned char fb_bytes[4];
+	Serialization::store<Serialization::Endian::little>(uint32_t{ 123 }, fb_bytes); // fb_bytes[0] == 123 everywhere
+	//SerializationBenchmark::serialization_benchmark();
 
 
 	// structs
@@ -286,6 +290,10 @@ int main()
 	Point* p_pointer = &p;
 	float* xptr = &p.x;
 
+	// a vector of points can only be searched point by point, for "which points are near here"
+	// see SpatialIndex.h - a k-d tree and a grid keep the coordinates as separate arrays of x and y
+	//SpatialIndexBenchmark::spatial_index_benchmark();
+
 	// we can define and initialize a struct in one line which is not super readable but ok
 	struct Point2 { float x, y; } p6{ 2.f, 12 };
 
@@ -0,0 +1,534 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../Common/Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPATIAL_INDEX_SSE2
+#endif
+
+// === spatial index ===
+// "which points lie in this rectangle", "which are the 10 closest to here" - answered by looking at every point
+// cost the same no matter how small the answer is, an index lets the query skip the parts of the plane
+// that cannot contain anything interesting
+//
+// KdTree - built once from all the points (bulk loading), splits the plane in halves until a few dozen points
+//	remain, every node knows the bounding box of its points so whole subtrees are skipped or taken at once
+// Grid - a uniform grid of cells, points can be inserted at any time (the dynamic variant)
+//
+// both keep the coordinates as separate arrays of x and y (structure of arrays), the points of a leaf or a cell
+// lie next to each other, so a leaf is tested four points at a time with SSE
+// the result of a query are ids - the index of the point in the original vector (KdTree) or the order of insertion (Grid)
+namespace SpatialIndex
+{
+	struct Point
+	{
+		float x, y;
+	};
+
+	struct Box
+	{
+		float min_x, min_y, max_x, max_y;
+
+		bool contains(const float x, const float y) const { return x >= min_x && x <= max_x && y >= min_y && y <= max_y; }
+		bool contains(const Box& other) const
+		{
+			return other.min_x >= min_x && other.max_x <= max_x && other.min_y >= min_y && other.max_y <= max_y;
+		}
+		bool intersects(const Box& other) const
+		{
+			return other.min_x <= max_x && other.max_x >= min_x && other.min_y <= max_y && other.max_y >= min_y;
+		}
+
+		// squared distance from the point to the nearest point of the box, 0 inside
+		float squared_distance(const Point p) const
+		{
+			const float dx = std::max({ min_x - p.x, 0.0f, p.x - max_x });
+			const float dy = std::max({ min_y - p.y, 0.0f, p.y - max_y });
+			return dx * dx + dy * dy;
+		}
+	};
+
+	// the k best candidates of a nearest neighbour query, the worst one on top of a max-heap
+	class Neighbours
+	{
+		std::vector<std::pair<float, uint32_t>> heap;
+		size_t k;
+
+	public:
+		explicit Neighbours(const size_t k) : k{ k } { heap.reserve(k); }
+
+		bool full() const { return heap.size() == k; }
+
+		// a candidate has to be closer than this to get in
+		float worst() const { return full() ? heap.front().first : std::numeric_limits<float>::infinity(); }
+
+		void offer(const float squared_distance, const uint32_t id)
+		{
+			if (k == 0)
+				return;
+			if (!full())
+			{
+				heap.emplace_back(squared_distance, id);
+				std::push_heap(heap.begin(), heap.end());
+			}
+			else if (squared_distance < heap.front().first)
+			{
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = { squared_distance, id };
+				std::push_heap(heap.begin(), heap.end());
+			}
+		}
+
+		// appends the ids from the closest to the farthest
+		void take(std::vector<uint32_t>& out)
+		{
+			std::sort_heap(heap.begin(), heap.end());
+			for (const auto& candidate : heap)
+				out.push_back(candidate.second);
+			heap.clear();
+		}
+	};
+
+	namespace Detail
+	{
+		// calls emit(id) for every point of the run inside the box
+		template <typename Emit> void scan_box(const float* xs, const float* ys, const uint32_t* ids, const size_t count,
+			const Box& box, Emit&& emit)
+		{
+			size_t i = 0;
+#ifdef SPATIAL_INDEX_SSE2
+			const __m128 min_x = _mm_set1_ps(box.min_x), max_x = _mm_set1_ps(box.max_x);
+			const __m128 min_y = _mm_set1_ps(box.min_y), max_y = _mm_set1_ps(box.max_y);
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 x = _mm_loadu_ps(xs + i);
+				const __m128 y = _mm_loadu_ps(ys + i);
+				const __m128 inside = _mm_and_ps(
+					_mm_and_ps(_mm_cmpge_ps(x, min_x), _mm_cmple_ps(x, max_x)),
+					_mm_and_ps(_mm_cmpge_ps(y, min_y), _mm_cmple_ps(y, max_y)));
+
+				// one bit per point, most groups of four are all in or all out
+				const int mask = _mm_movemask_ps(inside);
+				if (mask == 0)
+					continue;
+				for (int bit = 0; bit < 4; bit++)
+					if (mask & (1 << bit))
+						emit(ids[i + bit]);
+			}
+#endif
+			for (; i < count; i++)
+				if (box.contains(xs[i], ys[i]))
+					emit(ids[i]);
+		}
+
+		// squared distances of the run from the point, written to out
+		inline void squared_distances(const float* xs, const float* ys, const size_t count, const Point p, float* out)
+		{
+			size_t i = 0;
+#ifdef SPATIAL_INDEX_SSE2
+			const __m128 px = _mm_set1_ps(p.x), py = _mm_set1_ps(p.y);
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), px);
+				const __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), py);
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				const float dx = xs[i] - p.x, dy = ys[i] - p.y;
+				out[i] = dx * dx + dy * dy;
+			}
+		}
+
+		// distances are computed in blocks so the SIMD part does not depend on the size of the run
+		constexpr size_t distance_block = 64;
+
+		template <typename Emit> void scan_radius(const float* xs, const float* ys, const uint32_t* ids, const size_t count,
+			const Point center, const float radius, Emit&& emit)
+		{
+			const float limit = radius * radius;
+			float distances[distance_block];
+			for (size_t begin = 0; begin < count; begin += distance_block)
+			{
+				const size_t size = std::min(distance_block, count - begin);
+				squared_distances(xs + begin, ys + begin, size, center, distances);
+				for (size_t i = 0; i < size; i++)
+					if (distances[i] <= limit)
+						emit(ids[begin + i]);
+			}
+		}
+
+		inline void scan_nearest(const float* xs, const float* ys, const uint32_t* ids, const size_t count,
+			const Point p, Neighbours& neighbours)
+		{
+			float distances[distance_block];
+			for (size_t begin = 0; begin < count; begin += distance_block)
+			{
+				const size_t size = std::min(distance_block, count - begin);
+				squared_distances(xs + begin, ys + begin, size, p, distances);
+				for (size_t i = 0; i < size; i++)
+					if (distances[i] < neighbours.worst())
+						neighbours.offer(distances[i], ids[begin + i]);
+			}
+		}
+	}
+
+	// === brute force over the plain vector, what every query cost before the index ===
+	inline void linear_range(const std::vector<Point>& points, const Box& box, std::vector<uint32_t>& out)
+	{
+		for (size_t i = 0; i < points.size(); i++)
+			if (box.contains(points[i].x, points[i].y))
+				out.push_back(static_cast<uint32_t>(i));
+	}
+
+	inline void linear_radius(const std::vector<Point>& points, const Point center, const float radius, std::vector<uint32_t>& out)
+	{
+		const float limit = radius * radius;
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			const float dx = points[i].x - center.x, dy = points[i].y - center.y;
+			if (dx * dx + dy * dy <= limit)
+				out.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	inline void linear_nearest(const std::vector<Point>& points, const Point p, const size_t k, std::vector<uint32_t>& out)
+	{
+		Neighbours neighbours{ k };
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			const float dx = points[i].x - p.x, dy = points[i].y - p.y;
+			neighbours.offer(dx * dx + dy * dy, static_cast<uint32_t>(i));
+		}
+		neighbours.take(out);
+	}
+
+	class KdTree
+	{
+		struct Node
+		{
+			Box bounds;
+			uint32_t begin, end; // the points of the node are xs[begin, end)
+			uint32_t left;       // children are stored next to each other, 0 for a leaf (the root is never a child)
+		};
+
+		std::vector<float> xs, ys;
+		std::vector<uint32_t> ids;
+		std::vector<Node> nodes;
+		size_t leaf_size;
+
+		struct Entry
+		{
+			float x, y;
+			uint32_t id;
+		};
+
+		static Box bounds_of(const Entry* begin, const Entry* end)
+		{
+			Box box{ std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+				-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+			for (const Entry* e = begin; e != end; e++)
+			{
+				box.min_x = std::min(box.min_x, e->x);
+				box.max_x = std::max(box.max_x, e->x);
+				box.min_y = std::min(box.min_y, e->y);
+				box.max_y = std::max(box.max_y, e->y);
+			}
+			return box;
+		}
+
+		// splits at the median of the wider side, so the tree is balanced whatever the distribution
+		void build(std::vector<Entry>& entries, const size_t node, const uint32_t begin, const uint32_t end)
+		{
+			nodes[node] = { bounds_of(entries.data() + begin, entries.data() + end), begin, end, 0 };
+			if (end - begin <= leaf_size)
+				return;
+
+			const Box& box = nodes[node].bounds;
+			const bool split_x = box.max_x - box.min_x >= box.max_y - box.min_y;
+			const uint32_t middle = begin + (end - begin) / 2;
+			std::nth_element(entries.begin() + begin, entries.begin() + middle, entries.begin() + end,
+				[split_x](const Entry& a, const Entry& b) { return split_x ? a.x < b.x : a.y < b.y; });
+
+			const auto left = static_cast<uint32_t>(nodes.size());
+			nodes[node].left = left;
+			nodes.resize(nodes.size() + 2);
+			build(entries, left, begin, middle);
+			build(entries, left + 1, middle, end);
+		}
+
+		template <typename Emit> void range(const size_t node, const Box& box, Emit& emit) const
+		{
+			const Node& n = nodes[node];
+			if (!box.intersects(n.bounds))
+				return;
+
+			// the whole node is inside, no point has to be tested
+			if (box.contains(n.bounds))
+			{
+				for (uint32_t i = n.begin; i < n.end; i++)
+					emit(ids[i]);
+				return;
+			}
+
+			if (!n.left)
+			{
+				Detail::scan_box(xs.data() + n.begin, ys.data() + n.begin, ids.data() + n.begin, n.end - n.begin, box, emit);
+				return;
+			}
+			range(n.left, box, emit);
+			range(n.left + 1, box, emit);
+		}
+
+		void nearest(const size_t node, const Point p, Neighbours& neighbours) const
+		{
+			const Node& n = nodes[node];
+			if (!n.left)
+			{
+				Detail::scan_nearest(xs.data() + n.begin, ys.data() + n.begin, ids.data() + n.begin, n.end - n.begin, p, neighbours);
+				return;
+			}
+
+			// the closer child first, then the other one only if it can still contain something closer
+			const float left_distance = nodes[n.left].bounds.squared_distance(p);
+			const float right_distance = nodes[n.left + 1].bounds.squared_distance(p);
+			const uint32_t first = left_distance <= right_distance ? n.left : n.left + 1;
+			const uint32_t second = first == n.left ? n.left + 1 : n.left;
+
+			if (std::min(left_distance, right_distance) < neighbours.worst())
+				nearest(first, p, neighbours);
+			if (std::max(left_distance, right_distance) < neighbours.worst())
+				nearest(second, p, neighbours);
+		}
+
+	public:
+		explicit KdTree(const std::vector<Point>& points, const size_t leaf_size = 32) : leaf_size{ std::max<size_t>(leaf_size, 1) }
+		{
+			std::vector<Entry> entries(points.size());
+			for (size_t i = 0; i < points.size(); i++)
+				entries[i] = { points[i].x, points[i].y, static_cast<uint32_t>(i) };
+
+			nodes.reserve(2 * (points.size() / this->leaf_size + 1));
+			nodes.resize(1);
+			build(entries, 0, 0, static_cast<uint32_t>(entries.size()));
+
+			// leaves are now contiguous runs, the coordinates are copied out in that order
+			xs.resize(entries.size());
+			ys.resize(entries.size());
+			ids.resize(entries.size());
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				xs[i] = entries[i].x;
+				ys[i] = entries[i].y;
+				ids[i] = entries[i].id;
+			}
+		}
+
+		size_t size() const { return ids.size(); }
+
+		void range(const Box& box, std::vector<uint32_t>& out) const
+		{
+			if (ids.empty())
+				return;
+			auto emit = [&out](const uint32_t id) { out.push_back(id); };
+			range(0, box, emit);
+		}
+
+		void radius(const Point center, const float radius, std::vector<uint32_t>& out) const
+		{
+			if (ids.empty())
+				return;
+
+			radius_of(0, center, radius, out);
+		}
+
+		// the k closest points, from the closest
+		void nearest(const Point p, const size_t k, std::vector<uint32_t>& out) const
+		{
+			if (ids.empty() || k == 0)
+				return;
+			Neighbours neighbours{ k };
+			nearest(0, p, neighbours);
+			neighbours.take(out);
+		}
+
+	private:
+		// the nodes farther than the radius are skipped, the leaves touching the circle are scanned with the exact test
+		void radius_of(const size_t node, const Point center, const float radius, std::vector<uint32_t>& out) const
+		{
+			const Node& n = nodes[node];
+			if (n.bounds.squared_distance(center) > radius * radius)
+				return;
+
+			if (!n.left)
+			{
+				Detail::scan_radius(xs.data() + n.begin, ys.data() + n.begin, ids.data() + n.begin, n.end - n.begin,
+					center, radius, [&out](const uint32_t id) { out.push_back(id); });
+				return;
+			}
+			radius_of(n.left, center, radius, out);
+			radius_of(n.left + 1, center, radius, out);
+		}
+	};
+
+	// points can be added at any time, a query visits only the cells it overlaps
+	// the cell size should be chosen so a cell holds a few dozen points
+	// points outside the bounds are kept in the border cells, the queries still answer correctly, only slower
+	class Grid
+	{
+		struct Cell
+		{
+			std::vector<float> xs, ys;
+			std::vector<uint32_t> ids;
+		};
+
+		Box bounds;
+		float cell_size;
+		size_t columns, rows;
+		std::vector<Cell> cells;
+		uint32_t count = 0;
+
+		size_t column_of(const float x) const
+		{
+			const float column = std::floor((x - bounds.min_x) / cell_size);
+			return column <= 0 ? 0 : std::min(static_cast<size_t>(column), columns - 1);
+		}
+
+		size_t row_of(const float y) const
+		{
+			const float row = std::floor((y - bounds.min_y) / cell_size);
+			return row <= 0 ? 0 : std::min(static_cast<size_t>(row), rows - 1);
+		}
+
+		template <typename Visit> void for_each_cell(const Box& box, Visit&& visit) const
+		{
+			const size_t first_column = column_of(box.min_x), last_column = column_of(box.max_x);
+			const size_t first_row = row_of(box.min_y), last_row = row_of(box.max_y);
+			for (size_t row = first_row; row <= last_row; row++)
+				for (size_t column = first_column; column <= last_column; column++)
+				{
+					const Cell& cell = cells[row * columns + column];
+					if (!cell.ids.empty())
+						visit(cell);
+				}
+		}
+
+	public:
+		Grid(const Box& bounds, const float cell_size)
+			: bounds{ bounds }, cell_size{ cell_size },
+			columns{ std::max<size_t>(1, static_cast<size_t>(std::ceil((bounds.max_x - bounds.min_x) / cell_size))) },
+			rows{ std::max<size_t>(1, static_cast<size_t>(std::ceil((bounds.max_y - bounds.min_y) / cell_size))) },
+			cells(columns * rows) { }
+
+		// returns the id of the point
+		uint32_t insert(const Point p)
+		{
+			Cell& cell = cells[row_of(p.y) * columns + column_of(p.x)];
+			cell.xs.push_back(p.x);
+			cell.ys.push_back(p.y);
+			cell.ids.push_back(count);
+			return count++;
+		}
+
+		size_t size() const { return count; }
+
+		void range(const Box& box, std::vector<uint32_t>& out) const
+		{
+			for_each_cell(box, [&](const Cell& cell)
+			{
+				Detail::scan_box(cell.xs.data(), cell.ys.data(), cell.ids.data(), cell.ids.size(), box,
+					[&out](const uint32_t id) { out.push_back(id); });
+			});
+		}
+
+		void radius(const Point center, const float radius, std::vector<uint32_t>& out) const
+		{
+			const Box square{ center.x - radius, center.y - radius, center.x + radius, center.y + radius };
+			for_each_cell(square, [&](const Cell& cell)
+			{
+				Detail::scan_radius(cell.xs.data(), cell.ys.data(), cell.ids.data(), cell.ids.size(), center, radius,
+					[&out](const uint32_t id) { out.push_back(id); });
+			});
+		}
+
+		// visits rings of cells around the cell of the point, ring r are the cells r steps away
+		// stops when nothing outside the visited square can be closer than the current k-th candidate
+		void nearest(const Point p, const size_t k, std::vector<uint32_t>& out) const
+		{
+			if (k == 0)
+				return;
+
+			Neighbours neighbours{ k };
+			const auto column = static_cast<ptrdiff_t>(column_of(p.x));
+			const auto row = static_cast<ptrdiff_t>(row_of(p.y));
+			const auto last_column = static_cast<ptrdiff_t>(columns) - 1, last_row = static_cast<ptrdiff_t>(rows) - 1;
+
+			for (ptrdiff_t ring = 0;; ring++)
+			{
+				const ptrdiff_t left = column - ring, right = column + ring, bottom = row - ring, top = row + ring;
+				for (ptrdiff_t r = std::max<ptrdiff_t>(bottom, 0); r <= std::min(top, last_row); r++)
+					for (ptrdiff_t c = std::max<ptrdiff_t>(left, 0); c <= std::min(right, last_column); c++)
+					{
+						// only the border of the square, the inside was visited by the previous rings
+						if (r != bottom && r != top && c != left && c != right)
+							continue;
+						const Cell& cell = cells[static_cast<size_t>(r) * columns + static_cast<size_t>(c)];
+						Detail::scan_nearest(cell.xs.data(), cell.ys.data(), cell.ids.data(), cell.ids.size(), p, neighbours);
+					}
+
+				// the distance to the nearest unvisited cell, a side that reached the border of the grid has nothing behind it
+				// (the border cells also hold the points outside the bounds)
+				const float infinity = std::numeric_limits<float>::infinity();
+				const float to_left = left <= 0 ? infinity : p.x - (bounds.min_x + left * cell_size);
+				const float to_right = right >= last_column ? infinity : bounds.min_x + (right + 1) * cell_size - p.x;
+				const float to_bottom = bottom <= 0 ? infinity : p.y - (bounds.min_y + bottom * cell_size);
+				const float to_top = top >= last_row ? infinity : bounds.min_y + (top + 1) * cell_size - p.y;
+				const float unvisited = std::max(0.0f, std::min({ to_left, to_right, to_bottom, to_top }));
+
+				if (unvisited == infinity || (neighbours.full() && neighbours.worst() <= unvisited * unvisited))
+					break;
+			}
+			neighbours.take(out);
+		}
+	};
+
+	// === batched queries, many queries answered on all the cores ===
+	// results[i] belongs to queries[i], the queries are split into equal chunks, one per thread
+	// the index is only read, so any number of threads can query it as long as nobody inserts at the same time
+	template <typename Index> void range_batch(const Index& index, const std::vector<Box>& queries,
+		std::vector<std::vector<uint32_t>>& results, const unsigned thread_count = std::thread::hardware_concurrency())
+	{
+		results.resize(queries.size());
+		Parallel::for_each_chunk(queries.size(), thread_count, [&](unsigned, const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				results[i].clear();
+				index.range(queries[i], results[i]);
+			}
+		});
+	}
+
+	template <typename Index> void nearest_batch(const Index& index, const std::vector<Point>& queries, const size_t k,
+		std::vector<std::vector<uint32_t>>& results, const unsigned thread_count = std::thread::hardware_concurrency())
+	{
+		results.resize(queries.size());
+		Parallel::for_each_chunk(queries.size(), thread_count, [&](unsigned, const size_t begin, const size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				results[i].clear();
+				index.nearest(queries[i], k, results[i]);
+			}
+		});
+	}
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Common/Benchmark.h"
+#include "SpatialIndex.h"
+
+namespace SpatialIndexBenchmark
+{
+	using namespace SpatialIndex;
+
+	constexpr float world_size = 1000.0f;
+
+	// uniformly spread points, the same seed gives the same points every time
+	inline std::vector<Point> make_points(const size_t count, const unsigned seed = 42)
+	{
+		std::mt19937 random{ seed };
+		std::uniform_real_distribution<float> coordinate{ 0.0f, world_size };
+
+		std::vector<Point> points(count);
+		for (auto& p : points)
+			p = { coordinate(random), coordinate(random) };
+		return points;
+	}
+
+	// the linear scan answers only a few queries, otherwise the big sizes would run for minutes
+	// the indexes answer all of them and the first ones are compared with the linear results
+	inline void spatial_index_benchmark(const size_t point_count, const size_t query_count = 10'000, const unsigned seed = 42)
+	{
+		const auto points = make_points(point_count, seed);
+		const std::string suffix = ", " + std::to_string(point_count) + " points";
+		const size_t linear_count = std::min<size_t>(query_count, 20);
+		const size_t k = 10;
+
+		// boxes and circles holding about 64 points on average
+		const float side = world_size * std::sqrt(64.0f / static_cast<float>(point_count));
+		const float radius = side / std::sqrt(3.14159265f);
+		const auto centers = make_points(query_count, seed + 1);
+		std::vector<Box> boxes(query_count);
+		for (size_t i = 0; i < query_count; i++)
+			boxes[i] = { centers[i].x - side / 2, centers[i].y - side / 2, centers[i].x + side / 2, centers[i].y + side / 2 };
+
+		std::vector<uint32_t> out;
+		size_t found = 0;
+
+		// building, measured once and kept - at 100 million points there is no memory for a second copy
+		std::optional<KdTree> built_tree;
+		Benchmark::report("KdTree build" + suffix, Benchmark::measure([&] { built_tree.emplace(points); }, 1), point_count);
+		const KdTree& tree = *built_tree;
+
+		// the grid is sized for about 16 points per cell
+		const float cell_size = world_size * std::sqrt(16.0f / static_cast<float>(point_count));
+		std::optional<Grid> built_grid;
+		Benchmark::report("Grid insert" + suffix, Benchmark::measure([&]
+		{
+			built_grid.emplace(Box{ 0, 0, world_size, world_size }, cell_size);
+			for (const auto& p : points)
+				built_grid->insert(p);
+		}, 1), point_count);
+		const Grid& grid = *built_grid;
+
+		// the answers have to match the brute force, ids of the tree are indexes to points, grid ids are insertion order (the same)
+		auto sorted = [](std::vector<uint32_t> ids) { std::sort(ids.begin(), ids.end()); return ids; };
+		size_t mismatches = 0;
+		for (size_t i = 0; i < linear_count; i++)
+		{
+			std::vector<uint32_t> expected, from_tree, from_grid;
+			linear_range(points, boxes[i], expected);
+			tree.range(boxes[i], from_tree);
+			grid.range(boxes[i], from_grid);
+			mismatches += sorted(from_tree) != expected || sorted(from_grid) != expected;
+
+			expected.clear(), from_tree.clear(), from_grid.clear();
+			linear_nearest(points, centers[i], k, expected);
+			tree.nearest(centers[i], k, from_tree);
+			grid.nearest(centers[i], k, from_grid);
+			mismatches += sorted(from_tree) != sorted(expected) || sorted(from_grid) != sorted(expected);
+
+			expected.clear(), from_tree.clear(), from_grid.clear();
+			linear_radius(points, centers[i], radius, expected);
+			tree.radius(centers[i], radius, from_tree);
+			grid.radius(centers[i], radius, from_grid);
+			mismatches += sorted(from_tree) != expected || sorted(from_grid) != expected;
+		}
+		if (mismatches)
+			std::cout << "the indexes disagree with the linear scan in " << mismatches << " queries" << std::endl;
+
+		// range queries
+		Benchmark::report("linear range" + suffix, Benchmark::measure([&]
+		{
+			for (size_t i = 0; i < linear_count; i++)
+			{
+				out.clear();
+				linear_range(points, boxes[i], out);
+				found += out.size();
+			}
+		}, 1), linear_count);
+
+		Benchmark::report("KdTree range" + suffix, Benchmark::measure([&]
+		{
+			for (const auto& box : boxes)
+			{
+				out.clear();
+				tree.range(box, out);
+				found += out.size();
+			}
+		}), query_count);
+
+		Benchmark::report("Grid range" + suffix, Benchmark::measure([&]
+		{
+			for (const auto& box : boxes)
+			{
+				out.clear();
+				grid.range(box, out);
+				found += out.size();
+			}
+		}), query_count);
+
+		// k nearest neighbours
+		Benchmark::report("linear nearest" + suffix, Benchmark::measure([&]
+		{
+			for (size_t i = 0; i < linear_count; i++)
+			{
+				out.clear();
+				linear_nearest(points, centers[i], k, out);
+				found += out.size();
+			}
+		}, 1), linear_count);
+
+		Benchmark::report("KdTree nearest" + suffix, Benchmark::measure([&]
+		{
+			for (const auto& center : centers)
+			{
+				out.clear();
+				tree.nearest(center, k, out);
+				found += out.size();
+			}
+		}), query_count);
+
+		Benchmark::report("Grid nearest" + suffix, Benchmark::measure([&]
+		{
+			for (const auto& center : centers)
+			{
+				out.clear();
+				grid.nearest(center, k, out);
+				found += out.size();
+			}
+		}), query_count);
+
+		// radius
+		Benchmark::report("KdTree radius" + suffix, Benchmark::measure([&]
+		{
+			for (const auto& center : centers)
+			{
+				out.clear();
+				tree.radius(center, radius, out);
+				found += out.size();
+			}
+		}), query_count);
+
+		// batches on all the cores
+		std::vector<std::vector<uint32_t>> results;
+		Benchmark::report("KdTree range_batch (all threads)" + suffix,
+			Benchmark::measure([&] { range_batch(tree, boxes, results); }), query_count);
+		Benchmark::report("KdTree nearest_batch (all threads)" + suffix,
+			Benchmark::measure([&] { nearest_batch(tree, centers, k, results); }), query_count);
+
+		Benchmark::do_not_optimize(found);
+		Benchmark::do_not_optimize(results);
+	}
+
+	inline void spatial_index_benchmark()
+	{
+		spatial_index_benchmark(1'000'000);
+		spatial_index_benchmark(10'000'000);
+		spatial_index_benchmark(100'000'000);
+	}
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// tiny measuring helpers shared by the *_benchmark functions
+// the idea is the same as Stopwatch in C# - start, do the work, stop, read the elapsed time
+// on top of the time we count memory allocations and (on Linux, when the kernel lets us) hardware events
+namespace Benchmark
+{
+	// calls of the global operator new, only executables that replace the operator count them (see Benchmarks/main.cpp)
+	inline std::atomic<uint64_t> allocation_count{ 0 };
+
+	struct HardwareCounters
+	{
+		bool valid = false;
+		uint64_t cycles = 0;
+		uint64_t instructions = 0;
+		uint64_t cache_misses = 0;
+		uint64_t branch_misses = 0;
+	};
+
+	// perf_event_open counters of this thread and the threads it starts
+	// in containers or with kernel.perf_event_paranoid set high the events cannot be opened, then valid stays false
+	class PerfCounters
+	{
+#ifdef __linux__
+		int descriptors[4] = { -1, -1, -1, -1 };
+
+		static int open_event(const uint64_t config)
+		{
+			perf_event_attr attributes;
+			std::memset(&attributes, 0, sizeof(attributes));
+			attributes.type = PERF_TYPE_HARDWARE;
+			attributes.size = sizeof(attributes);
+			attributes.config = config;
+			attributes.disabled = 1;
+			attributes.inherit = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+		}
+
+		uint64_t read_event(const int index) const
+		{
+			uint64_t value = 0;
+			if (read(descriptors[index], &value, sizeof(value)) != sizeof(value))
+				return 0;
+			return value;
+		}
+
+	public:
+		PerfCounters()
+		{
+			const uint64_t events[4] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+			for (int i = 0; i < 4; i++)
+				descriptors[i] = open_event(events[i]);
+		}
+
+		~PerfCounters()
+		{
+			for (const int descriptor : descriptors)
+				if (descriptor >= 0)
+					close(descriptor);
+		}
+
+		bool available() const { return descriptors[0] >= 0 && descriptors[1] >= 0; }
+
+		void start()
+		{
+			for (const int descriptor : descriptors)
+				if (descriptor >= 0)
+				{
+					ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+					ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+				}
+		}
+
+		HardwareCounters stop()
+		{
+			for (const int descriptor : descriptors)
+				if (descriptor >= 0)
+					ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+
+			HardwareCounters counters;
+			if (!available())
+				return counters;
+
+			counters.valid = true;
+			counters.cycles = read_event(0);
+			counters.instructions = read_event(1);
+			counters.cache_misses = descriptors[2] >= 0 ? read_event(2) : 0;
+			counters.branch_misses = descriptors[3] >= 0 ? read_event(3) : 0;
+			return counters;
+		}
+#else
+	public:
+		bool available() const { return false; }
+		void start() { }
+		HardwareCounters stop() { return {}; }
+#endif
+
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters& operator=(const PerfCounters&) = delete;
+
+		// opened once for the whole process
+		static PerfCounters& instance()
+		{
+			static PerfCounters counters;
+			return counters;
+		}
+	};
+
+	// everything we know about the best run
+	struct Measurement
+	{
+		double nanoseconds = 0;
+		uint64_t allocations = 0;
+		HardwareCounters counters;
+	};
+
+	// runs the function several times and returns the best run
+	// the best run is the least disturbed by the OS, caches warming up etc.
+	template <typename Func> Measurement measure(Func&& func, const int repetitions = 5)
+	{
+		Measurement best;
+		PerfCounters& perf = PerfCounters::instance();
+
+		for (int i = 0; i < repetitions; i++)
+		{
+			const uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+			perf.start();
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const auto stop = std::chrono::steady_clock::now();
+			const HardwareCounters counters = perf.stop();
+			const uint64_t allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+			const double elapsed = std::chrono::duration<double, std::nano>(stop - start).count();
+			if (i == 0 || elapsed < best.nanoseconds)
+				best = { elapsed, allocations, counters };
+		}
+		return best;
+	}
+
+	inline const volatile void* sink = nullptr;
+
+	// prevents the compiler from throwing away calculations which result is never used
+	template <typename T> void do_not_optimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "g"(&value) : "memory");
+#else
+		sink = &value;
+#endif
+	}
+
+	struct Result
+	{
+		std::string context;
+		std::string name;
+		size_t items;
+		Measurement measurement;
+	};
+
+	// every reported measurement is kept so the whole run can be saved at the end
+	inline std::vector<Result>& results()
+	{
+		static std::vector<Result> all;
+		return all;
+	}
+
+	// describes what is being run at the moment (for example the benchmark and its size), stored with every result
+	inline std::string& context()
+	{
+		static std::string current;
+		return current;
+	}
+
+	inline void report(const std::string& name, const Measurement& measurement, const size_t items)
+	{
+		std::cout << name << ": "
+			<< measurement.nanoseconds / items << " ns/op, "
+			<< items * 1e9 / measurement.nanoseconds << " items/s, "
+			<< double(measurement.allocations) / items << " allocations/op";
+
+		const HardwareCounters& c = measurement.counters;
+		if (c.valid)
+			std::cout << ", " << double(c.cycles) / items << " cycles/op, "
+				<< (c.cycles ? double(c.instructions) / c.cycles : 0.0) << " IPC, "
+				<< double(c.cache_misses) / items << " cache misses/op, "
+				<< double(c.branch_misses) / items << " branch misses/op";
+		std::cout << std::endl;
+
+		results().push_back({ context(), name, items, measurement });
+	}
+
+	inline std::string json_string(const std::string& text)
+	{
+		std::string result = "\"";
+		for (const char c : text)
+		{
+			if (c == '"' || c == '\\')
+				result += '\\';
+			result += c;
+		}
+		return result + "\"";
+	}
+
+	// one object per result, two runs can be compared by matching context and name
+	inline bool write_json(const std::string& path)
+	{
+		std::ofstream file{ path };
+		if (!file)
+			return false;
+
+		file << "{\n  \"results\": [";
+		bool first = true;
+		for (const auto& r : results())
+		{
+			const Measurement& m = r.measurement;
+			file << (first ? "\n" : ",\n") << "    { "
+				<< "\"context\": " << json_string(r.context) << ", "
+				<< "\"name\": " << json_string(r.name) << ", "
+				<< "\"items\": " << r.items << ", "
+				<< "\"ns_per_op\": " << m.nanoseconds / r.items << ", "
+				<< "\"items_per_second\": " << r.items * 1e9 / m.nanoseconds << ", "
+				<< "\"allocations_per_op\": " << double(m.allocations) / r.items;
+			if (m.counters.valid)
+				file << ", \"cycles_per_op\": " << double(m.counters.cycles) / r.items
+					<< ", \"instructions_per_op\": " << double(m.counters.instructions) / r.items
+					<< ", \"cache_misses_per_op\": " << double(m.counters.cache_misses) / r.items
+					<< ", \"branch_misses_per_op\": " << double(m.counters.branch_misses) / r.items;
+			file << " }";
+			first = false;
+		}
+		file << "\n  ]\n}\n";
+		return bool(file);
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// === replacements for std::function on hot paths ===
+// std::function can hold any callable of any size, so a lambda capturing more than a few pointers
+// ends up on the heap, and every call goes through a pointer the compiler cannot see through
+//
+// inline_function<Signature, Capacity> - owns the callable but keeps it inside the object itself
+//	a callable that does not fit is a compilation error, so it never allocates
+//	it is move-only, copying a callable with captures is rarely what we want in a loop anyway
+//
+// function_ref<Signature> - does not own anything, just a pointer to the callable and a pointer to a call function
+//	two pointers in size, trivially copyable, perfect as a parameter of a function that calls the callback and returns
+//	the callable has to outlive the function_ref (same as with any reference)
+
+template <typename Signature, size_t Capacity = 4 * sizeof(void*)> class inline_function;
+
+template <typename R, typename... Args, size_t Capacity> class inline_function<R(Args...), Capacity>
+{
+	alignas(std::max_align_t) unsigned char storage[Capacity];
+
+	R (*invoker)(void*, Args&&...) = nullptr;
+
+	// moves the callable from source to destination and destroys the source, when destination is null only destroys
+	void (*manager)(void* destination, void* source) = nullptr;
+
+	template <typename F> static R invoke(void* callable, Args&&... args)
+	{
+		return (*static_cast<F*>(callable))(std::forward<Args>(args)...);
+	}
+
+	template <typename F> static void manage(void* destination, void* source)
+	{
+		F* callable = static_cast<F*>(source);
+		if (destination)
+			::new (destination) F(std::move(*callable));
+		callable->~F();
+	}
+
+	void reset()
+	{
+		if (manager)
+			manager(nullptr, storage);
+		invoker = nullptr;
+		manager = nullptr;
+	}
+
+	void take(inline_function& other)
+	{
+		if (other.manager)
+			other.manager(storage, other.storage);
+		invoker = other.invoker;
+		manager = other.manager;
+		other.invoker = nullptr;
+		other.manager = nullptr;
+	}
+
+public:
+	inline_function() = default;
+
+	template <typename F, typename Callable = std::decay_t<F>,
+		typename = std::enable_if_t<!std::is_same_v<Callable, inline_function> && std::is_invocable_r_v<R, Callable&, Args...>>>
+	inline_function(F&& f)
+	{
+		static_assert(sizeof(Callable) <= Capacity, "the callable does not fit, increase the capacity of inline_function");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "the callable is over-aligned");
+		static_assert(std::is_nothrow_move_constructible_v<Callable>, "the callable has to be nothrow move constructible");
+
+		::new (static_cast<void*>(storage)) Callable(std::forward<F>(f));
+		invoker = &invoke<Callable>;
+		manager = &manage<Callable>;
+	}
+
+	inline_function(inline_function&& other) noexcept { take(other); }
+
+	inline_function& operator=(inline_function&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			take(other);
+		}
+		return *this;
+	}
+
+	inline_function(const inline_function&) = delete;
+	inline_function& operator=(const inline_function&) = delete;
+
+	~inline_function() { reset(); }
+
+	explicit operator bool() const { return invoker != nullptr; }
+
+	R operator()(Args... args) const
+	{
+		// the callable may change its own state (mutable lambdas) same as with std::function
+		return invoker(const_cast<unsigned char*>(storage), std::forward<Args>(args)...);
+	}
+};
+
+template <typename Signature> class function_ref;
+
+template <typename R, typename... Args> class function_ref<R(Args...)>
+{
+	// plain functions cannot be pointed to by void* so they get their own member
+	union
+	{
+		void* object;
+		R (*function)(Args...);
+	};
+
+	R (*invoker)(const function_ref&, Args&&...);
+
+public:
+	template <typename F, typename Callable = std::remove_reference_t<F>,
+		typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, function_ref> && std::is_invocable_r_v<R, Callable&, Args...>>>
+	function_ref(F&& f) noexcept
+	{
+		if constexpr (std::is_function_v<Callable> || std::is_pointer_v<std::decay_t<F>>)
+		{
+			function = f;
+			invoker = [](const function_ref& self, Args&&... args) -> R
+			{
+				return self.function(std::forward<Args>(args)...);
+			};
+		}
+		else
+		{
+			object = const_cast<void*>(static_cast<const void*>(std::addressof(f)));
+			invoker = [](const function_ref& self, Args&&... args) -> R
+			{
+				return (*static_cast<Callable*>(self.object))(std::forward<Args>(args)...);
+			};
+		}
+	}
+
+	R operator()(Args... args) const { return invoker(*this, std::forward<Args>(args)...); }
+};
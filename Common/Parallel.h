@@ -0,0 +1,36 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// === splitting a loop over threads ===
+// [0, count) is cut into equal chunks, one per thread, and the calling thread takes the first chunk
+// instead of just waiting for the others
+// starting a thread costs tens of microseconds, so a thread is started only for every min_items_per_thread items,
+// a small input runs on the calling thread alone
+namespace Parallel
+{
+	constexpr size_t min_items_per_thread = 1024;
+
+	// how many chunks for_each_chunk uses, size per-chunk results with it
+	inline unsigned thread_count_for(const size_t count, const unsigned requested = std::thread::hardware_concurrency())
+	{
+		return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(requested, count / min_items_per_thread + 1)));
+	}
+
+	// calls work(chunk, begin, end) for every chunk, chunk goes from 0 to thread_count_for(count, requested) - 1
+	template <typename Work> void for_each_chunk(const size_t count, const unsigned requested, Work work)
+	{
+		const unsigned thread_count = thread_count_for(count, requested);
+		const size_t chunk = (count + thread_count - 1) / thread_count;
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 1; t < thread_count; t++)
+			threads.emplace_back(work, t, std::min(t * chunk, count), std::min((t + 1) * chunk, count));
+
+		work(0u, size_t{ 0 }, std::min(chunk, count));
+		for (auto& thread : threads)
+			thread.join();
+	}
+}
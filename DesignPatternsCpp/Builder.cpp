@@ -1,10 +1,17 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <memory>
 #include <tuple>
 #include <fstream>
+#include <memory_resource>
+#include "Instrumentation.h"
+#include "MemoryResources.h"
+#include "SmallVector.h"
+#include "Symbol.h"
+#include "../Common/Benchmark.h"
 using namespace std;
 
 // some objects are complicated and required a lot of work to be created
@@ -12,12 +19,49 @@ using namespace std;
 // instead, opt for piecewise construction
 // builder provides an API for constructing an object step-by-step
 
+// the value of an attribute owned through a single pointer, 8 bytes instead of the 32 of a std::string
+// values are mostly urls, too long for the small string buffer anyway, so the one allocation is paid either way
+class AttributeValue
+{
+	unique_ptr<char[]> characters; // null-terminated, null when the value is empty
+
+public:
+	AttributeValue(const string_view value)
+	{
+		if (value.empty())
+			return;
+		characters.reset(new char[value.size() + 1]);
+		value.copy(characters.get(), value.size());
+		characters[value.size()] = '\0';
+	}
+	AttributeValue(const AttributeValue& other) : AttributeValue{ other.view() } { }
+	AttributeValue(AttributeValue&&) noexcept = default;
+	AttributeValue& operator=(const AttributeValue& other) { return *this = AttributeValue{ other }; }
+	AttributeValue& operator=(AttributeValue&&) noexcept = default;
+
+	string_view view() const { return characters ? string_view{ characters.get() } : string_view{}; }
+
+	friend std::ostream& operator<<(std::ostream& os, const AttributeValue& value) { return os << value.view(); }
+};
+
+struct Attribute
+{
+	Symbol key;
+	AttributeValue value;
+
+	Attribute(const Symbol key, const string_view value) : key{ key }, value{ value } { }
+};
+
 // domain specific language approach
 struct Tag
 {
-	string name, text;
+	// names and attribute keys repeat in every document, so they are interned symbols (one pointer each)
+	// most tags have at most one attribute (img src, a href), it is kept inside the tag without an allocation
+	// an attribute is two pointers, so the inline slot keeps Tag smaller than with a std::vector of string pairs
+	Symbol name;
+	string text;
 	vector<Tag> children;
-	vector<pair<string, string>> attributes;
+	SmallVector<Attribute, 1> attributes;
 
 	// print all the tags and childrean
 	friend std::ostream& operator<<(std::ostream& os, const Tag& tag)
@@ -25,7 +69,7 @@ struct Tag
 		os << "<" << tag.name;
 
 		for (const auto& att : tag.attributes)
-			os << " " << att.first << "=\"" << att.second << "\"";
+			os << " " << att.key << "=\"" << att.value << "\"";
 
 		if (tag.children.size() == 0 && tag.text.length() == 0)
 		{
@@ -45,25 +89,33 @@ struct Tag
 	}
 
 protected:
-	Tag(const string &name, const string &text) : name(name), text(text) {}
-	Tag(const string &name, const vector<Tag> &childrean)
-		: name(name), children(children) { }
+	Tag(Symbol name, const string &text) : name(name), text(text) {}
+	Tag(Symbol name, vector<Tag> children)
+		: name(name), children(move(children)) { }
 
 };
 
 struct P : Tag
 {
-	explicit P(const string &text) : Tag("p", text) { }
+	// interned once, constructing a tag does not touch the symbol table
+	static Symbol symbol() { static const Symbol p{ "p" }; return p; }
+
+	explicit P(const string &text) : Tag(symbol(), text) { }
+
+	// the elements of an initializer_list are const, so they are copied once into the vector and the vector is moved
 	P(std::initializer_list<Tag> children)
-		: Tag("p", children) { }
+		: Tag(symbol(), vector<Tag>(children)) { }
 };
 
 struct IMG : Tag
 {
+	static Symbol symbol() { static const Symbol img{ "img" }; return img; }
+
 	explicit IMG(const string& url)
-		: Tag{ "img", "" }
+		: Tag{ symbol(), "" }
 	{
-		attributes.emplace_back(make_pair("src", url));
+		static const Symbol src{ "src" };
+		attributes.emplace_back(src, url);
 	}
 };
 
@@ -72,17 +124,32 @@ struct HtmlBuilder;
 
 struct HtmlElement
 {
-	string name;
-	string text;
-	vector<HtmlElement> elements;
+	// all the strings and children of the element come from one memory resource (the global heap by default)
+	// a whole tree built in an arena can be thrown away at once by releasing the arena
+	using allocator_type = pmr::polymorphic_allocator<char>;
+
+	Symbol name; // interned, shared with Tag
+	pmr::string text;
+	pmr::vector<HtmlElement> elements;
 	const size_t indent_size = 2;
 
 	HtmlElement() {}
-	HtmlElement(const string& name, const string& text)
-		: name(name), text(text) { }
+	explicit HtmlElement(const allocator_type& allocator)
+		: text(allocator), elements(allocator) { }
+	HtmlElement(const string& name, const string& text, const allocator_type& allocator = {})
+		: name(name), text(text, allocator), elements(allocator) { }
+
+	// containers construct children with their own allocator, these are the constructors they use
+	HtmlElement(const HtmlElement& other, const allocator_type& allocator)
+		: name(other.name), text(other.text, allocator), elements(other.elements, allocator) { }
+	HtmlElement(HtmlElement&& other, const allocator_type& allocator)
+		: name(other.name), text(move(other.text), allocator), elements(move(other.elements), allocator) { }
+	HtmlElement(const HtmlElement&) = default;
+	HtmlElement(HtmlElement&&) = default;
 
 	string str(int indent = 0) const
 	{
+		INSTRUMENT_COUNT(html_nodes, 1);
 		ostringstream oss;
 		string i(indent_size*indent, ' ');
 		oss << i << "<" << name << ">" << endl;
@@ -93,20 +160,17 @@ struct HtmlElement
 			oss << e.str(indent + 1);
 
 		oss << i << "</" << name << ">" << endl;
-		return oss.str();
+		string html = oss.str();
+		// children are part of the parent's text, so only the outermost call counts the bytes
+		INSTRUMENT_COUNT(html_bytes, indent == 0 ? html.size() : 0);
+		return html;
 	}
 
 	// referece based API
-	static HtmlBuilder build_ref(string root_name)
-	{
-		return HtmlBuilder(root_name);
-	}
+	static HtmlBuilder build_ref(string root_name);
 
 	// pointer based API
-	static unique_ptr<HtmlBuilder> build_ptr(string root_name)
-	{
-		return make_unique<HtmlBuilder>(root_name);
-	}
+	static unique_ptr<HtmlBuilder> build_ptr(string root_name);
 };
 
 class HtmlBuilder
@@ -114,7 +178,8 @@ class HtmlBuilder
 	HtmlElement root;
 
 public:
-	HtmlBuilder(string root_name)
+	HtmlBuilder(string root_name, pmr::memory_resource* resource = pmr::get_default_resource())
+		: root{ resource }
 	{
 		root.name = root_name;
 	}
@@ -126,29 +191,205 @@ public:
 	// more primitive not fluent interface
 	void add_child(string child_name, string child_text)
 	{
-		HtmlElement e{ child_name, child_text };
-		root.elements.emplace_back(e);
+		// constructed in place, so the child gets the memory resource of the root
+		root.elements.emplace_back(child_name, child_text);
 	}
 
 	// fluent reference based - provides method chaining ability
 	HtmlBuilder& add_child_fluent_ref(string child_name, string child_text)
 	{
-		HtmlElement e{ child_name, child_text };
-		root.elements.emplace_back(e);
+		root.elements.emplace_back(child_name, child_text);
 		return *this;
 	}
 
 	// fluent pointer based - provides method chaining ability
 	HtmlBuilder* add_child_fluent_ptr(string child_name, string child_text)
 	{
-		HtmlElement e{ child_name, child_text };
-		root.elements.emplace_back(e);
+		root.elements.emplace_back(child_name, child_text);
 		return this;
 	}
 
-	string str() { return root.str(); }
+	string str()
+	{
+		INSTRUMENT_SPAN("HtmlBuilder::str");
+		return root.str();
+	}
 };
 
+// HtmlBuilder has to be complete before it can be returned by value
+inline HtmlBuilder HtmlElement::build_ref(string root_name)
+{
+	return HtmlBuilder(root_name);
+}
+
+inline unique_ptr<HtmlBuilder> HtmlElement::build_ptr(string root_name)
+{
+	return make_unique<HtmlBuilder>(root_name);
+}
+
+// the three ways of adding children and rendering the result
+void html_builder_benchmark(const size_t child_count = 10000)
+{
+	Benchmark::report("HtmlBuilder::add_child", Benchmark::measure([&]
+	{
+		HtmlBuilder builder{ "ul" };
+		for (size_t i = 0; i < child_count; i++)
+			builder.add_child("li", "hello");
+		Benchmark::do_not_optimize(builder);
+	}), child_count);
+
+	Benchmark::report("HtmlBuilder::add_child_fluent_ref", Benchmark::measure([&]
+	{
+		HtmlBuilder builder{ "ul" };
+		for (size_t i = 0; i < child_count; i++)
+			builder.add_child_fluent_ref("li", "hello");
+		Benchmark::do_not_optimize(builder);
+	}), child_count);
+
+	Benchmark::report("HtmlBuilder::add_child_fluent_ptr", Benchmark::measure([&]
+	{
+		auto builder = HtmlElement::build_ptr("ul");
+		HtmlBuilder* current = builder.get();
+		for (size_t i = 0; i < child_count; i++)
+			current = current->add_child_fluent_ptr("li", "hello");
+		Benchmark::do_not_optimize(builder);
+	}), child_count);
+
+	HtmlBuilder builder{ "ul" };
+	for (size_t i = 0; i < child_count; i++)
+		builder.add_child("li", "hello");
+
+	string html;
+	Benchmark::report("HtmlElement::str", Benchmark::measure([&] { html = builder.str(); }), child_count);
+	Benchmark::do_not_optimize(html);
+}
+
+// the same document built with the global heap and with different memory resources
+void html_builder_memory_benchmark(const size_t child_count = 1000, const int repetitions = 200)
+{
+	auto build = [child_count](pmr::memory_resource* resource)
+	{
+		HtmlBuilder builder{ "ul", resource };
+		for (size_t i = 0; i < child_count; i++)
+			builder.add_child_fluent_ref("li", "list item with a text too long for the small string buffer");
+		Benchmark::do_not_optimize(builder);
+	};
+
+	CountingResource heap;
+	const auto heap_time = Benchmark::measure([&] { for (int i = 0; i < repetitions; i++) build(&heap); });
+	Benchmark::report("HtmlBuilder, global heap", heap_time, child_count * repetitions);
+	heap.get_statistics().print("global heap");
+
+	PoolResource pool;
+	const auto pool_time = Benchmark::measure([&] { for (int i = 0; i < repetitions; i++) build(&pool); });
+	Benchmark::report("HtmlBuilder, pool", pool_time, child_count * repetitions);
+	pool.get_statistics().print("pool");
+
+	// the arena is released after every document - one request, one arena
+	ArenaResource arena;
+	const auto arena_time = Benchmark::measure([&]
+	{
+		for (int i = 0; i < repetitions; i++)
+		{
+			build(&arena);
+			arena.release();
+		}
+	});
+	Benchmark::report("HtmlBuilder, arena", arena_time, child_count * repetitions);
+	arena.get_statistics().print("arena");
+}
+
+// the DSL tags against the same tags stored the old way (every name and attribute key its own string)
+void tag_benchmark(const size_t tag_count = 100000)
+{
+	struct StringTag
+	{
+		string name, text;
+		vector<StringTag> children;
+		vector<pair<string, string>> attributes;
+	};
+
+	// every tag pays its own size, the string based tag pays a separate heap block for its attributes on top
+	cout << "every tag: Tag " << sizeof(Tag) << " bytes, string based tag " << sizeof(StringTag) << " bytes" << endl
+		<< "an attribute adds: Tag nothing for the first one, string based tag "
+		<< sizeof(pair<string, string>) << " bytes on the heap" << endl;
+
+	const string url = "http://pokemon.com/pikachu.png";
+
+	Benchmark::report("StringTag, img", Benchmark::measure([&]
+	{
+		vector<StringTag> tags;
+		tags.reserve(tag_count);
+		for (size_t i = 0; i < tag_count; i++)
+		{
+			StringTag& tag = tags.emplace_back();
+			tag.name = "img";
+			tag.attributes.emplace_back("src", url);
+		}
+		Benchmark::do_not_optimize(tags);
+	}), tag_count);
+
+	Benchmark::report("Tag, img", Benchmark::measure([&]
+	{
+		vector<Tag> tags;
+		tags.reserve(tag_count);
+		for (size_t i = 0; i < tag_count; i++)
+			tags.push_back(IMG{ url });
+		Benchmark::do_not_optimize(tags);
+	}), tag_count);
+
+	// tags without attributes, most of a document
+	Benchmark::report("StringTag, p text", Benchmark::measure([&]
+	{
+		vector<StringTag> tags;
+		tags.reserve(tag_count);
+		for (size_t i = 0; i < tag_count; i++)
+		{
+			StringTag& tag = tags.emplace_back();
+			tag.name = "p";
+			tag.text = "hello";
+		}
+		Benchmark::do_not_optimize(tags);
+	}), tag_count);
+
+	Benchmark::report("Tag, p text", Benchmark::measure([&]
+	{
+		vector<Tag> tags;
+		tags.reserve(tag_count);
+		for (size_t i = 0; i < tag_count; i++)
+			tags.push_back(P{ "hello" });
+		Benchmark::do_not_optimize(tags);
+	}), tag_count);
+
+	// a paragraph with two images, three tags per item
+	Benchmark::report("StringTag, p { img, img }", Benchmark::measure([&]
+	{
+		vector<StringTag> tags;
+		tags.reserve(tag_count);
+		for (size_t i = 0; i < tag_count; i++)
+		{
+			StringTag& tag = tags.emplace_back();
+			tag.name = "p";
+			for (int j = 0; j < 2; j++)
+			{
+				StringTag& image = tag.children.emplace_back();
+				image.name = "img";
+				image.attributes.emplace_back("src", url);
+			}
+		}
+		Benchmark::do_not_optimize(tags);
+	}), tag_count);
+
+	Benchmark::report("Tag, p { img, img }", Benchmark::measure([&]
+	{
+		vector<Tag> tags;
+		tags.reserve(tag_count);
+		for (size_t i = 0; i < tag_count; i++)
+			tags.push_back(P{ IMG{ url }, IMG{ url } });
+		Benchmark::do_not_optimize(tags);
+	}), tag_count);
+}
+
 int demo()
 {
 	// <p>hello</p>
@@ -186,10 +427,11 @@ int demo()
 	cout << builder2.str() << endl;
 
 	// same as above but different internal implementation
-	auto builder3 = HtmlElement::build_ptr("ul")
-		->add_child_fluent_ptr("li", "hello")
+	// the unique_ptr owns the builder, it has to be kept - the raw pointers returned by the chain point into it
+	auto builder3 = HtmlElement::build_ptr("ul");
+	builder3->add_child_fluent_ptr("li", "hello")
 		->add_child_fluent_ptr("li", "world");
-	cout << builder3 << endl;
+	cout << builder3->str() << endl;
 
 
 	// domain specific language approach
@@ -0,0 +1,275 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// bounded lock-free queues used to connect threads working in a pipeline
+// both of them have a fixed capacity - when the queue is full the producer has to wait
+// this is called backpressure, a slow consumer slows down the producer instead of letting the queue grow forever
+
+// on x64 one cache line is 64 bytes, keeping the producer's and consumer's data in separate lines
+// prevents false sharing (two cores fighting over the same line while touching different variables)
+constexpr size_t cache_line_size = 64;
+
+inline size_t round_up_to_power_of_two(const size_t value)
+{
+	size_t result = 1;
+	while (result < value)
+		result <<= 1;
+	return result;
+}
+
+// number of elements between head and tail while producers and consumers may be moving both
+// head is read first: the head can only pass a tail that was already there, so the tail read after it
+// is never behind it - read the other way round, the consumers could move the head past the tail that was read
+// and the subtraction would wrap around to a huge number
+// between the two loads more elements can come and go, so the result is also clamped to the capacity
+inline size_t queue_size(const std::atomic<size_t>& head, const std::atomic<size_t>& tail, const size_t capacity)
+{
+	const size_t h = head.load(std::memory_order_acquire);
+	const size_t t = tail.load(std::memory_order_acquire);
+	return t > h ? std::min(t - h, capacity) : 0;
+}
+
+// where a thread that cannot go on (the queue is empty or full) waits
+// first it spins a little - in a busy pipeline the other side usually answers within microseconds
+// and going to sleep and waking up costs more than that - then it sleeps until notify() is called,
+// so an idle or backpressured thread stops using the CPU
+// notify() costs one atomic instruction as long as nobody sleeps, the mutex is taken only when somebody does
+class Parking
+{
+	static constexpr int spin_count = 64;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::atomic<unsigned> sleepers{ 0 };
+
+	// the sleeper announces itself and then checks, the notifier changes the state and then checks for sleepers
+	// both do it with a read-modify-write of sleepers, those are ordered one after the other, so either the notifier
+	// sees the sleeper or the sleeper (synchronized with the notifier) sees the change - a wakeup is never lost
+	// (a fence would do the same without writing, but the thread sanitizer does not understand fences)
+	template <typename Sleep> bool park(Sleep sleep)
+	{
+		std::unique_lock<std::mutex> lock{ mutex };
+		sleepers.fetch_add(1, std::memory_order_acq_rel);
+		const bool ready = sleep(lock);
+		sleepers.fetch_sub(1, std::memory_order_relaxed);
+		return ready;
+	}
+
+public:
+	// returns when ready() is true
+	template <typename Ready> void wait(Ready ready)
+	{
+		for (int i = 0; i < spin_count; i++)
+		{
+			if (ready())
+				return;
+			std::this_thread::yield();
+		}
+		park([&](std::unique_lock<std::mutex>& lock) { condition.wait(lock, ready); return true; });
+	}
+
+	// returns ready() - true when it became true, false when the deadline passed first
+	template <typename Clock, typename Duration, typename Ready>
+	bool wait_until(const std::chrono::time_point<Clock, Duration> deadline, Ready ready)
+	{
+		for (int i = 0; i < spin_count; i++)
+		{
+			if (ready())
+				return true;
+			if (Clock::now() >= deadline)
+				return false;
+			std::this_thread::yield();
+		}
+		return park([&](std::unique_lock<std::mutex>& lock) { return condition.wait_until(lock, deadline, ready); });
+	}
+
+	// call after the change that can make ready() true
+	void notify()
+	{
+		if (sleepers.fetch_add(0, std::memory_order_acq_rel) == 0)
+			return;
+
+		// a sleeper holds the mutex from announcing itself until it sleeps, taking it here makes sure
+		// the notification does not fall between its check and its sleep
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+		}
+		condition.notify_all();
+	}
+};
+
+// single producer single consumer queue - the cheapest possible one
+// only one thread may push and only one thread may pop
+template <typename T> class SpscQueue
+{
+	std::vector<T> slots;
+	const size_t mask;
+
+	// head is written only by the consumer and tail only by the producer
+	alignas(cache_line_size) std::atomic<size_t> head{ 0 };
+	alignas(cache_line_size) std::atomic<size_t> tail{ 0 };
+
+	// the producer waits here when the queue is full and the consumer when it is empty
+	alignas(cache_line_size) Parking parking;
+
+public:
+	// capacity is rounded up to a power of two so we can use & instead of %
+	explicit SpscQueue(const size_t capacity)
+		: slots(round_up_to_power_of_two(capacity)), mask(slots.size() - 1) { }
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	size_t capacity() const { return slots.size(); }
+	// only a snapshot while other threads work, see queue_size
+	size_t size() const { return queue_size(head, tail, slots.size()); }
+
+	// value is moved into the queue only when there was space for it
+	bool try_push(T& value)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == slots.size())
+			return false;
+
+		slots[t & mask] = std::move(value);
+		tail.store(t + 1, std::memory_order_release);
+		parking.notify();
+		return true;
+	}
+
+	bool try_pop(T& value)
+	{
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+
+		value = std::move(slots[h & mask]);
+		head.store(h + 1, std::memory_order_release);
+		parking.notify();
+		return true;
+	}
+
+	// blocks as long as the queue is full
+	void push(T value)
+	{
+		while (!try_push(value))
+			parking.wait([this] { return size() < slots.size(); });
+	}
+
+	// blocks as long as the queue is empty
+	T pop()
+	{
+		T value{};
+		while (!try_pop(value))
+			parking.wait([this] { return size() > 0; });
+		return value;
+	}
+};
+
+// multiple producers multiple consumers queue (Dmitry Vyukov's bounded queue)
+// every cell has a sequence number that tells whether it is ready to be written or read
+// so threads only compete for the head or tail counter and never block each other for longer
+template <typename T> class MpmcQueue
+{
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::vector<Cell> cells;
+	const size_t mask;
+
+	alignas(cache_line_size) std::atomic<size_t> head{ 0 };
+	alignas(cache_line_size) std::atomic<size_t> tail{ 0 };
+	alignas(cache_line_size) Parking parking;
+
+public:
+	explicit MpmcQueue(const size_t capacity)
+		: cells(round_up_to_power_of_two(capacity)), mask(cells.size() - 1)
+	{
+		for (size_t i = 0; i < cells.size(); i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	MpmcQueue(const MpmcQueue&) = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	size_t capacity() const { return cells.size(); }
+	size_t size() const { return queue_size(head, tail, cells.size()); }
+
+	bool try_push(T& value)
+	{
+		size_t position = tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = cells[position & mask];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+			if (difference == 0)
+			{
+				// the cell is free, try to claim it
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(position + 1, std::memory_order_release);
+					parking.notify();
+					return true;
+				}
+			}
+			else if (difference < 0)
+				return false; // the queue is full
+			else
+				position = tail.load(std::memory_order_relaxed); // somebody was faster
+		}
+	}
+
+	bool try_pop(T& value)
+	{
+		size_t position = head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = cells[position & mask];
+			const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+
+			if (difference == 0)
+			{
+				if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell.value);
+					cell.sequence.store(position + mask + 1, std::memory_order_release);
+					parking.notify();
+					return true;
+				}
+			}
+			else if (difference < 0)
+				return false; // the queue is empty
+			else
+				position = head.load(std::memory_order_relaxed);
+		}
+	}
+
+	void push(T value)
+	{
+		while (!try_push(value))
+			parking.wait([this] { return size() < cells.size(); });
+	}
+
+	T pop()
+	{
+		T value{};
+		while (!try_pop(value))
+			parking.wait([this] { return size() > 0; });
+		return value;
+	}
+};
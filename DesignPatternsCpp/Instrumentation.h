@@ -0,0 +1,255 @@
+#pragma once
+
+// === hot path instrumentation ===
+// counters and timing spans that tell where the time goes (spec evaluation, vector growth, rendering...)
+// everything is behind macros - without ENABLE_INSTRUMENTATION defined they expand to nothing,
+// so the instrumented code compiles exactly as if the instrumentation was not there
+//
+//	INSTRUMENT_COUNT(counter, value)                 adds value to one of the Instrumentation::Counter counters
+//	INSTRUMENT_SPAN("name")                          measures the enclosing scope and stores it in the trace
+//	INSTRUMENT_SAMPLED(index, counter, statement)    times the statement for every 1024th index only
+//	                                                 (a sample includes the cost of reading the clock, tens of ns)
+//
+// every thread writes only to its own data (counters padded to a cache line, its own ring buffer of spans)
+// so threads never wait for each other and never share a cache line
+// the ring buffer keeps the latest spans, older ones are overwritten
+// a thread gives its slot back when it exits and the next thread keeps adding to the same counters and ring,
+// so threads started on every call are all counted, threads running one after another share a lane in the trace
+// threads above max_threads running at the same time are not instrumented, print_totals reports how many
+// reading the results (totals, write_chrome_trace) is meant to happen when the measured work is finished
+
+#ifdef ENABLE_INSTRUMENTATION
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "ConcurrentQueue.h"
+
+namespace Instrumentation
+{
+	enum class Counter
+	{
+		filter_items_scanned,
+		filter_matches,
+		filter_spec_samples,
+		filter_spec_sample_nanoseconds,
+		html_nodes,
+		html_bytes,
+		relations_scanned,
+		count
+	};
+
+	inline const char* counter_name(const Counter counter)
+	{
+		static const char* const names[] = {
+			"filter items scanned", "filter matches", "filter spec samples", "filter spec sample ns",
+			"html nodes", "html bytes", "relations scanned" };
+		return names[static_cast<size_t>(counter)];
+	}
+
+	constexpr size_t counter_count = static_cast<size_t>(Counter::count);
+	constexpr size_t max_threads = 64;
+	constexpr size_t ring_size = 4096; // has to be a power of two
+	constexpr size_t sample_mask = 1023;
+
+	struct Span
+	{
+		const char* name;
+		uint64_t start_nanoseconds;
+		uint64_t duration_nanoseconds;
+	};
+
+	struct alignas(cache_line_size) ThreadData
+	{
+		// only the owning thread writes, so a relaxed load and store is enough (no locked instruction)
+		std::array<std::atomic<uint64_t>, counter_count> counters{};
+		alignas(cache_line_size) std::atomic<uint64_t> spans_written{ 0 };
+		std::array<Span, ring_size> spans{};
+		size_t thread_index = 0;
+	};
+
+	inline std::array<std::atomic<ThreadData*>, max_threads> threads{};
+	inline std::array<std::atomic<bool>, max_threads> slot_taken{};
+	inline std::atomic<size_t> dropped_threads{ 0 };
+
+	// the first instrumented call of a thread takes a free slot
+	// the data of a slot is allocated by its first thread and never freed, a reader can never see it disappear
+	// taking a slot (acquire) and giving it back (release) order the writes of one owner before the next one's
+	inline ThreadData* take_slot()
+	{
+		for (size_t index = 0; index < max_threads; index++)
+		{
+			bool expected = false;
+			if (slot_taken[index].load(std::memory_order_relaxed) ||
+				!slot_taken[index].compare_exchange_strong(expected, true, std::memory_order_acquire))
+				continue;
+
+			ThreadData* data = threads[index].load(std::memory_order_relaxed);
+			if (!data)
+			{
+				data = new ThreadData;
+				data->thread_index = index;
+				threads[index].store(data, std::memory_order_release);
+			}
+			return data;
+		}
+
+		dropped_threads.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	// gives the slot back when the thread exits
+	struct ThreadSlot
+	{
+		ThreadData* const data = take_slot();
+
+		~ThreadSlot()
+		{
+			if (data)
+				slot_taken[data->thread_index].store(false, std::memory_order_release);
+		}
+	};
+
+	inline ThreadData* this_thread()
+	{
+		thread_local ThreadSlot slot;
+		return slot.data;
+	}
+
+	inline uint64_t now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	inline void add(const Counter counter, const uint64_t value)
+	{
+		if (ThreadData* data = this_thread())
+		{
+			auto& c = data->counters[static_cast<size_t>(counter)];
+			c.store(c.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+	}
+
+	class ScopedSpan
+	{
+		const char* name;
+		uint64_t start;
+
+	public:
+		explicit ScopedSpan(const char* name) : name{ name }, start{ now() } { }
+
+		ScopedSpan(const ScopedSpan&) = delete;
+		ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+		~ScopedSpan()
+		{
+			const uint64_t end = now();
+			if (ThreadData* data = this_thread())
+			{
+				const uint64_t index = data->spans_written.load(std::memory_order_relaxed);
+				data->spans[index & (ring_size - 1)] = { name, start, end - start };
+				data->spans_written.store(index + 1, std::memory_order_release);
+			}
+		}
+	};
+
+	// counters summed over all the threads
+	inline std::array<uint64_t, counter_count> totals()
+	{
+		std::array<uint64_t, counter_count> result{};
+		for (auto& slot : threads)
+			if (ThreadData* data = slot.load(std::memory_order_acquire))
+				for (size_t i = 0; i < counter_count; i++)
+					result[i] += data->counters[i].load(std::memory_order_relaxed);
+		return result;
+	}
+
+	inline void print_totals()
+	{
+		const auto values = totals();
+		for (size_t i = 0; i < counter_count; i++)
+			std::cout << counter_name(static_cast<Counter>(i)) << ": " << values[i] << std::endl;
+
+		if (const size_t dropped = dropped_threads.load(std::memory_order_relaxed))
+			std::cout << "threads not instrumented (more than " << max_threads << " at the same time): " << dropped << std::endl;
+
+		const auto samples = values[static_cast<size_t>(Counter::filter_spec_samples)];
+		if (samples)
+			std::cout << "average spec evaluation: "
+				<< double(values[static_cast<size_t>(Counter::filter_spec_sample_nanoseconds)]) / samples << " ns" << std::endl;
+	}
+
+	// Chrome trace format, open it in chrome://tracing or https://ui.perfetto.dev
+	inline bool write_chrome_trace(const std::string& path)
+	{
+		std::ofstream file{ path };
+		if (!file)
+			return false;
+
+		// timestamps are in microseconds, fixed notation keeps the nanoseconds of a long running process
+		file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+		bool first = true;
+		for (auto& slot : threads)
+		{
+			ThreadData* data = slot.load(std::memory_order_acquire);
+			if (!data)
+				continue;
+
+			const uint64_t written = data->spans_written.load(std::memory_order_acquire);
+			const uint64_t begin = written > ring_size ? written - ring_size : 0;
+			for (uint64_t i = begin; i < written; i++)
+			{
+				const Span& span = data->spans[i & (ring_size - 1)];
+				file << (first ? "\n" : ",\n")
+					<< "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << data->thread_index
+					<< ",\"ts\":" << span.start_nanoseconds / 1000.0 << ",\"dur\":" << span.duration_nanoseconds / 1000.0 << "}";
+				first = false;
+			}
+		}
+		file << "\n]}\n";
+		return bool(file);
+	}
+}
+
+#define INSTRUMENT_CONCAT_INNER(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_INNER(a, b)
+
+#define INSTRUMENT_COUNT(counter, value) \
+	::Instrumentation::add(::Instrumentation::Counter::counter, static_cast<uint64_t>(value))
+
+#define INSTRUMENT_SPAN(name) \
+	::Instrumentation::ScopedSpan INSTRUMENT_CONCAT(instrument_span_, __LINE__){ name }
+
+#define INSTRUMENT_SAMPLED(index, counter, statement) \
+	do \
+	{ \
+		if (((index) & ::Instrumentation::sample_mask) == 0) \
+		{ \
+			const uint64_t instrument_start = ::Instrumentation::now(); \
+			statement; \
+			INSTRUMENT_COUNT(counter, ::Instrumentation::now() - instrument_start); \
+			INSTRUMENT_COUNT(filter_spec_samples, 1); \
+		} \
+		else \
+		{ \
+			statement; \
+		} \
+	} while (false)
+
+#else
+
+#define INSTRUMENT_COUNT(counter, value) ((void)0)
+#define INSTRUMENT_SPAN(name) ((void)0)
+#define INSTRUMENT_SAMPLED(index, counter, statement) \
+	do \
+	{ \
+		statement; \
+	} while (false)
+
+#endif
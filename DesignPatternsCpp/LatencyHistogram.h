@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// collects durations into buckets growing by the power of two: [0, 1us), [1us, 2us), [2us, 4us) and so on
+// recording is just a few instructions and needs no memory allocation so it can be used on hot paths
+// a histogram belongs to one thread, histograms from many threads can be merged afterwards
+class LatencyHistogram
+{
+	static constexpr size_t bucket_count = 32;
+
+	std::array<uint64_t, bucket_count> buckets{};
+	uint64_t count = 0;
+	uint64_t total_microseconds = 0;
+	uint64_t max_microseconds = 0;
+
+	static size_t bucket_of(uint64_t microseconds)
+	{
+		size_t bucket = 0;
+		while (microseconds && bucket < bucket_count - 1)
+		{
+			microseconds >>= 1;
+			bucket++;
+		}
+		return bucket;
+	}
+
+public:
+	void record(const std::chrono::steady_clock::duration duration)
+	{
+		const auto microseconds = static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+
+		buckets[bucket_of(microseconds)]++;
+		count++;
+		total_microseconds += microseconds;
+		if (microseconds > max_microseconds)
+			max_microseconds = microseconds;
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		for (size_t i = 0; i < bucket_count; i++)
+			buckets[i] += other.buckets[i];
+		count += other.count;
+		total_microseconds += other.total_microseconds;
+		if (other.max_microseconds > max_microseconds)
+			max_microseconds = other.max_microseconds;
+	}
+
+	uint64_t get_count() const { return count; }
+	uint64_t get_max_microseconds() const { return max_microseconds; }
+	double get_mean_microseconds() const { return count ? double(total_microseconds) / count : 0.0; }
+
+	// upper bound of the bucket containing the given percentile (0-100)
+	uint64_t get_percentile_microseconds(const double percentile) const
+	{
+		const auto wanted = static_cast<uint64_t>(count * percentile / 100.0);
+		uint64_t seen = 0;
+		for (size_t i = 0; i < bucket_count; i++)
+		{
+			seen += buckets[i];
+			if (seen > wanted || seen == count)
+				return uint64_t(1) << i;
+		}
+		return max_microseconds;
+	}
+
+	void print(const std::string& name) const
+	{
+		std::cout << name << ": " << count << " samples, mean " << get_mean_microseconds()
+			<< " us, p50 < " << get_percentile_microseconds(50)
+			<< " us, p99 < " << get_percentile_microseconds(99)
+			<< " us, max " << max_microseconds << " us" << std::endl;
+
+		for (size_t i = 0; i < bucket_count; i++)
+			if (buckets[i])
+				std::cout << "  < " << (uint64_t(1) << i) << " us: " << buckets[i] << std::endl;
+	}
+};
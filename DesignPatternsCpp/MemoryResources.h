@@ -0,0 +1,247 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <string>
+
+// === memory resources ===
+// by default every std::string and std::vector gets its memory from the global heap (new/delete)
+// the heap is general purpose so it has to be thread-safe, fight fragmentation, remember sizes etc.
+// often we know more - for example that everything created while handling one request dies together
+// std::pmr containers take a memory_resource, so the same container can be fed by a faster allocator
+//
+// ArenaResource - hands out memory by moving a pointer forward, deallocation does nothing
+//	everything is given back at once by release() (or the destructor) regardless of how many objects were created
+// PoolResource - keeps separate free lists for a few block sizes, freed blocks are reused by the next allocation
+//	of the same size class, bigger requests go directly to the upstream resource
+// CountingResource - forwards everything to the upstream resource and only counts, good for measuring
+//
+// none of them is thread-safe, one resource should be used by one thread (for example one per request)
+
+struct ResourceStatistics
+{
+	size_t bytes_in_use = 0;
+	size_t peak_bytes = 0;
+	size_t total_bytes = 0;
+	size_t allocation_count = 0;
+	size_t deallocation_count = 0;
+
+	void allocated(const size_t bytes)
+	{
+		bytes_in_use += bytes;
+		total_bytes += bytes;
+		allocation_count++;
+		peak_bytes = std::max(peak_bytes, bytes_in_use);
+	}
+
+	void deallocated(const size_t bytes)
+	{
+		bytes_in_use -= bytes;
+		deallocation_count++;
+	}
+
+	void print(const std::string& name) const
+	{
+		std::cout << name << ": " << allocation_count << " allocations, " << total_bytes << " bytes in total, "
+			<< peak_bytes << " bytes at peak, " << bytes_in_use << " bytes in use" << std::endl;
+	}
+};
+
+class CountingResource : public std::pmr::memory_resource
+{
+	std::pmr::memory_resource* upstream;
+	ResourceStatistics statistics;
+
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+		: upstream{ upstream } { }
+
+	const ResourceStatistics& get_statistics() const { return statistics; }
+
+protected:
+	void* do_allocate(const size_t bytes, const size_t alignment) override
+	{
+		void* p = upstream->allocate(bytes, alignment);
+		statistics.allocated(bytes);
+		return p;
+	}
+
+	void do_deallocate(void* p, const size_t bytes, const size_t alignment) override
+	{
+		upstream->deallocate(p, bytes, alignment);
+		statistics.deallocated(bytes);
+	}
+
+	bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+class ArenaResource : public std::pmr::memory_resource
+{
+	// chunks form a linked list, the header sits at the beginning of every chunk
+	struct Chunk
+	{
+		Chunk* previous;
+		size_t size;
+	};
+
+	std::pmr::memory_resource* upstream;
+	Chunk* last_chunk = nullptr;
+	std::byte* current = nullptr;
+	std::byte* end = nullptr;
+	size_t next_chunk_size;
+	ResourceStatistics statistics;
+
+	void grow(const size_t bytes, const size_t alignment)
+	{
+		// every next chunk is twice as big so the number of chunks stays logarithmic
+		const size_t needed = sizeof(Chunk) + bytes + alignment;
+		const size_t size = std::max(next_chunk_size, needed);
+		next_chunk_size = size * 2;
+
+		auto* chunk = static_cast<Chunk*>(upstream->allocate(size, alignof(std::max_align_t)));
+		chunk->previous = last_chunk;
+		chunk->size = size;
+		last_chunk = chunk;
+
+		current = reinterpret_cast<std::byte*>(chunk + 1);
+		end = reinterpret_cast<std::byte*>(chunk) + size;
+	}
+
+public:
+	explicit ArenaResource(const size_t initial_chunk_size = 64 * 1024,
+		std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+		: upstream{ upstream }, next_chunk_size{ initial_chunk_size } { }
+
+	ArenaResource(const ArenaResource&) = delete;
+	ArenaResource& operator=(const ArenaResource&) = delete;
+
+	~ArenaResource() override
+	{
+		release();
+		if (last_chunk)
+			upstream->deallocate(last_chunk, last_chunk->size, alignof(std::max_align_t));
+	}
+
+	// frees everything that was ever allocated from the arena, objects are not destroyed
+	// the biggest (last) chunk is kept, so an arena released after every request stops allocating soon
+	void release()
+	{
+		if (!last_chunk)
+			return;
+
+		while (Chunk* previous = last_chunk->previous)
+		{
+			last_chunk->previous = previous->previous;
+			upstream->deallocate(previous, previous->size, alignof(std::max_align_t));
+		}
+		current = reinterpret_cast<std::byte*>(last_chunk + 1);
+		statistics.bytes_in_use = 0;
+	}
+
+	const ResourceStatistics& get_statistics() const { return statistics; }
+
+protected:
+	void* do_allocate(const size_t bytes, const size_t alignment) override
+	{
+		auto address = reinterpret_cast<uintptr_t>(current);
+		auto aligned = (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+		if (!current || aligned + bytes > reinterpret_cast<uintptr_t>(end))
+		{
+			grow(bytes, alignment);
+			address = reinterpret_cast<uintptr_t>(current);
+			aligned = (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+		}
+
+		current = reinterpret_cast<std::byte*>(aligned + bytes);
+		statistics.allocated(bytes);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	// memory is given back only by release()
+	void do_deallocate(void*, const size_t, const size_t) override { statistics.deallocation_count++; }
+
+	bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
+
+class PoolResource : public std::pmr::memory_resource
+{
+	// size classes 16, 32, 64 ... 4096 bytes
+	static constexpr size_t smallest_block = 16;
+	static constexpr size_t class_count = 9;
+	static constexpr size_t largest_block = smallest_block << (class_count - 1);
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	// blocks are carved out of an arena, freed blocks go to the free list of their class
+	ArenaResource blocks;
+	std::array<FreeBlock*, class_count> free_lists{};
+	std::pmr::memory_resource* upstream;
+	ResourceStatistics statistics;
+
+	static size_t class_of(const size_t bytes)
+	{
+		size_t index = 0;
+		size_t size = smallest_block;
+		while (size < bytes)
+		{
+			size <<= 1;
+			index++;
+		}
+		return index;
+	}
+
+public:
+	explicit PoolResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+		: blocks{ 64 * 1024, upstream }, upstream{ upstream } { }
+
+	PoolResource(const PoolResource&) = delete;
+	PoolResource& operator=(const PoolResource&) = delete;
+
+	// frees all the pooled blocks at once, big allocations have to be freed by their owners as usual
+	void release()
+	{
+		blocks.release();
+		free_lists.fill(nullptr);
+		statistics.bytes_in_use = 0;
+	}
+
+	const ResourceStatistics& get_statistics() const { return statistics; }
+
+protected:
+	void* do_allocate(const size_t bytes, const size_t alignment) override
+	{
+		statistics.allocated(bytes);
+		if (bytes > largest_block || alignment > smallest_block)
+			return upstream->allocate(bytes, alignment);
+
+		const size_t index = class_of(bytes);
+		if (FreeBlock* block = free_lists[index])
+		{
+			free_lists[index] = block->next;
+			return block;
+		}
+		return blocks.allocate(smallest_block << index, smallest_block);
+	}
+
+	void do_deallocate(void* p, const size_t bytes, const size_t alignment) override
+	{
+		statistics.deallocated(bytes);
+		if (bytes > largest_block || alignment > smallest_block)
+		{
+			upstream->deallocate(p, bytes, alignment);
+			return;
+		}
+
+		const size_t index = class_of(bytes);
+		free_lists[index] = ::new (p) FreeBlock{ free_lists[index] };
+	}
+
+	bool do_is_equal(const memory_resource& other) const noexcept override { return this == &other; }
+};
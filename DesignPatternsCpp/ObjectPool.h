@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "ConcurrentQueue.h"
+
+// keeps a fixed number of objects and hands them out again and again
+// once the pool is filled no more memory is allocated, objects (and the buffers they own) are simply reused
+// the pool is bounded - when all objects are in use acquire() waits until somebody gives one back
+template <typename T> class ObjectPool
+{
+	MpmcQueue<std::unique_ptr<T>> available;
+	const size_t object_count;
+
+public:
+	// prepare is called once for every object, for example to reserve the memory it will need later on
+	template <typename Prepare> ObjectPool(const size_t object_count, Prepare prepare)
+		: available{ object_count }, object_count{ object_count }
+	{
+		for (size_t i = 0; i < object_count; i++)
+		{
+			auto object = std::make_unique<T>();
+			prepare(*object);
+			available.push(std::move(object));
+		}
+	}
+
+	explicit ObjectPool(const size_t object_count)
+		: ObjectPool(object_count, [](T&) { }) { }
+
+	size_t size() const { return object_count; }
+	size_t available_count() const { return available.size(); }
+
+	std::unique_ptr<T> acquire() { return available.pop(); }
+
+	bool try_acquire(std::unique_ptr<T>& object) { return available.try_pop(object); }
+
+	void release(std::unique_ptr<T> object) { available.push(std::move(object)); }
+};
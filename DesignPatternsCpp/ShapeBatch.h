@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Solid
+{
+	// === structure of arrays ===
+	// instead of keeping a vector of objects (array of structures) we keep one vector per field
+	// all widths lie next to each other in memory, so do all heights
+	// a loop that touches only widths and heights does not drag anything else through the cache
+	// and the compiler can process several shapes with a single SIMD instruction
+	//
+	// there is no virtual dispatch here - the kind of every shape is just another column
+	// and the square invariant (width == height) is kept by the bulk operations themselves
+	class ShapeBatch
+	{
+		std::vector<int> widths;
+		std::vector<int> heights;
+
+		// all bits set for squares and zero for rectangles
+		// a mask lets us choose between two values without branching: (a & mask) | (b & ~mask)
+		std::vector<int> square_masks;
+
+	public:
+		enum class Kind { rectangle, square };
+
+		size_t size() const { return widths.size(); }
+
+		void reserve(const size_t capacity)
+		{
+			widths.reserve(capacity);
+			heights.reserve(capacity);
+			square_masks.reserve(capacity);
+		}
+
+		void clear()
+		{
+			widths.clear();
+			heights.clear();
+			square_masks.clear();
+		}
+
+		void add_rectangle(const int width, const int height)
+		{
+			widths.push_back(width);
+			heights.push_back(height);
+			square_masks.push_back(0);
+		}
+
+		void add_square(const int size)
+		{
+			widths.push_back(size);
+			heights.push_back(size);
+			square_masks.push_back(-1);
+		}
+
+		Kind get_kind(const size_t index) const { return square_masks[index] ? Kind::square : Kind::rectangle; }
+		int get_width(const size_t index) const { return widths[index]; }
+		int get_height(const size_t index) const { return heights[index]; }
+
+		// area of every shape, result[i] corresponds to the i-th shape
+		void area(std::vector<int>& result) const
+		{
+			const size_t count = size();
+			result.resize(count);
+
+			const int* w = widths.data();
+			const int* h = heights.data();
+			int* r = result.data();
+			for (size_t i = 0; i < count; i++)
+				r[i] = w[i] * h[i];
+		}
+
+		long long total_area() const
+		{
+			const size_t count = size();
+			const int* w = widths.data();
+			const int* h = heights.data();
+
+			long long total = 0;
+			for (size_t i = 0; i < count; i++)
+				total += static_cast<long long>(w[i]) * h[i]; // widened before multiplying, the product of two ints can overflow
+			return total;
+		}
+
+		// the same as calling set_width on every object
+		// rectangles change only the width, squares change both sides
+		void set_width(const int width)
+		{
+			const size_t count = size();
+			int* w = widths.data();
+			int* h = heights.data();
+			const int* m = square_masks.data();
+			for (size_t i = 0; i < count; i++)
+			{
+				w[i] = width;
+				h[i] = (width & m[i]) | (h[i] & ~m[i]);
+			}
+		}
+
+		// the same as calling set_height on every object ("set height, keep invariant")
+		void set_height(const int height)
+		{
+			const size_t count = size();
+			int* w = widths.data();
+			int* h = heights.data();
+			const int* m = square_masks.data();
+			for (size_t i = 0; i < count; i++)
+			{
+				w[i] = (height & m[i]) | (w[i] & ~m[i]);
+				h[i] = height;
+			}
+		}
+
+		// the same as calling set_width(width) and then set_height(height) on every object
+		// so squares end up being height x height
+		void resize(const int width, const int height)
+		{
+			const size_t count = size();
+			int* w = widths.data();
+			int* h = heights.data();
+			const int* m = square_masks.data();
+			for (size_t i = 0; i < count; i++)
+			{
+				w[i] = (height & m[i]) | (width & ~m[i]);
+				h[i] = height;
+			}
+		}
+
+		// scaling both sides by the same factor never breaks the square invariant
+		void scale(const int factor)
+		{
+			const size_t count = size();
+			int* w = widths.data();
+			int* h = heights.data();
+			for (size_t i = 0; i < count; i++)
+			{
+				w[i] *= factor;
+				h[i] *= factor;
+			}
+		}
+	};
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <utility>
+
+// === vector with inline storage ===
+// std::vector allocates on the first push_back even when it only ever holds one or two elements
+// SmallVector keeps the first N elements inside the object itself and moves them to the heap
+// only when the (N + 1)th element arrives, so small collections cost no allocation at all
+// the price is a bigger object (N elements are always reserved) and moves that move the elements one by one
+template <typename T, size_t N> class SmallVector
+{
+	static_assert(N > 0, "use std::vector when there is no inline storage");
+
+	// 32-bit sizes keep the header at two words, small vectors are never that big
+	T* first;
+	uint32_t count = 0;
+	uint32_t capacity_ = N;
+	alignas(T) unsigned char buffer[N * sizeof(T)];
+
+	T* inline_data() { return reinterpret_cast<T*>(buffer); }
+	bool is_inline() const { return first == reinterpret_cast<const T*>(buffer); }
+
+	void free_heap()
+	{
+		if (!is_inline())
+			std::allocator<T>{}.deallocate(first, capacity_);
+	}
+
+	void grow(const size_t new_capacity)
+	{
+		T* elements = std::allocator<T>{}.allocate(new_capacity);
+		std::uninitialized_move(first, first + count, elements);
+		std::destroy(first, first + count);
+		free_heap();
+		first = elements;
+		capacity_ = static_cast<uint32_t>(new_capacity);
+	}
+
+	// takes the elements of other, a heap buffer is stolen, inline elements have to be moved one by one
+	void take(SmallVector& other)
+	{
+		if (other.is_inline())
+		{
+			first = inline_data();
+			capacity_ = N;
+			std::uninitialized_move(other.first, other.first + other.count, first);
+			count = other.count;
+			other.clear();
+		}
+		else
+		{
+			first = other.first;
+			count = other.count;
+			capacity_ = other.capacity_;
+			other.first = other.inline_data();
+			other.count = 0;
+			other.capacity_ = N;
+		}
+	}
+
+public:
+	SmallVector() : first{ inline_data() } { }
+
+	SmallVector(std::initializer_list<T> values) : SmallVector{}
+	{
+		reserve(values.size());
+		for (const auto& value : values)
+			push_back(value);
+	}
+
+	SmallVector(const SmallVector& other) : SmallVector{}
+	{
+		reserve(other.count);
+		std::uninitialized_copy(other.begin(), other.end(), first);
+		count = other.count;
+	}
+
+	SmallVector(SmallVector&& other) noexcept { take(other); }
+
+	SmallVector& operator=(const SmallVector& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			reserve(other.count);
+			std::uninitialized_copy(other.begin(), other.end(), first);
+			count = other.count;
+		}
+		return *this;
+	}
+
+	SmallVector& operator=(SmallVector&& other) noexcept
+	{
+		if (this != &other)
+		{
+			clear();
+			free_heap();
+			take(other);
+		}
+		return *this;
+	}
+
+	~SmallVector()
+	{
+		clear();
+		free_heap();
+	}
+
+	void reserve(const size_t new_capacity)
+	{
+		if (new_capacity > capacity_)
+			grow(new_capacity);
+	}
+
+	template <typename... Args> T& emplace_back(Args&&... args)
+	{
+		if (count < capacity_)
+		{
+			T* element = ::new (static_cast<void*>(first + count)) T(std::forward<Args>(args)...);
+			count++;
+			return *element;
+		}
+
+		// the arguments may refer to an element of this vector (v.push_back(v[0])), so the new element
+		// is built in the new buffer while the old elements are still alive, only then are they moved over
+		const size_t new_capacity = size_t{ capacity_ } * 2;
+		T* elements = std::allocator<T>{}.allocate(new_capacity);
+		T* element;
+		try
+		{
+			element = ::new (static_cast<void*>(elements + count)) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			std::allocator<T>{}.deallocate(elements, new_capacity);
+			throw;
+		}
+		std::uninitialized_move(first, first + count, elements);
+		std::destroy(first, first + count);
+		free_heap();
+		first = elements;
+		capacity_ = static_cast<uint32_t>(new_capacity);
+		count++;
+		return *element;
+	}
+
+	void push_back(const T& value) { emplace_back(value); }
+	void push_back(T&& value) { emplace_back(std::move(value)); }
+
+	void clear()
+	{
+		std::destroy(first, first + count);
+		count = 0;
+	}
+
+	size_t size() const { return count; }
+	size_t capacity() const { return capacity_; }
+	bool empty() const { return count == 0; }
+
+	T& operator[](const size_t index) { return first[index]; }
+	const T& operator[](const size_t index) const { return first[index]; }
+
+	T* begin() { return first; }
+	T* end() { return first + count; }
+	const T* begin() const { return first; }
+	const T* end() const { return first + count; }
+};
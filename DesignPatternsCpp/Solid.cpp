@@ -1,6 +1,28 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <array>
+#include <algorithm>
+#include <fstream>
+#include <memory_resource>
+#include <string_view>
+#include <random>
+#include "ConcurrentQueue.h"
+#include "Instrumentation.h"
+#include "LatencyHistogram.h"
+#include "MemoryResources.h"
+#include "ObjectPool.h"
+#include "ShapeBatch.h"
+#include "../Common/Benchmark.h"
+#include "../Common/InlineFunction.h"
+#include "../Common/Parallel.h"
 using namespace std;
 
 namespace Solid
@@ -12,6 +34,10 @@ namespace Solid
 		enum class Color { red, green, blue };
 		enum class Size { small, medium, large };
 
+		// number of values of the enums above, the aggregations use them to size their arrays
+		static constexpr size_t color_count = 3;
+		static constexpr size_t size_count = 3;
+
 		struct Product
 		{
 			string name;
@@ -60,7 +86,7 @@ namespace Solid
 			virtual bool is_satisfied(T* item) const = 0;
 
 			// it breakes OCP a bit as we have to extend the Specification class afterwards
-			template <typename T> AndSpecification<T> operator&& (const Specification<T>& second)
+			template <typename U> AndSpecification<U> operator&& (const Specification<U>& second)
 			{
 				return { *this, second };
 			}
@@ -75,10 +101,48 @@ namespace Solid
 		{
 			vector<Product*> filter(vector<Product*> items, Specification<Product> &spec) override
 			{
+				INSTRUMENT_SPAN("BetterFilter::filter");
+				vector<Product*> result;
+				for (size_t i = 0; i < items.size(); i++)
+				{
+					bool satisfied;
+					INSTRUMENT_SAMPLED(i, filter_spec_sample_nanoseconds, satisfied = spec.is_satisfied(items[i]));
+					if (satisfied)
+						result.push_back(items[i]);
+				}
+				// counted once per call, not per item
+				INSTRUMENT_COUNT(filter_items_scanned, items.size());
+				INSTRUMENT_COUNT(filter_matches, result.size());
+				return result;
+			}
+
+			// the result takes its memory from the given resource, for example an arena of the current request
+			pmr::vector<Product*> filter(const vector<Product*>& items, Specification<Product>& spec, pmr::memory_resource* resource)
+			{
+				INSTRUMENT_SPAN("BetterFilter::filter");
+				pmr::vector<Product*> result{ resource };
+				for (size_t i = 0; i < items.size(); i++)
+				{
+					bool satisfied;
+					INSTRUMENT_SAMPLED(i, filter_spec_sample_nanoseconds, satisfied = spec.is_satisfied(items[i]));
+					if (satisfied)
+						result.push_back(items[i]);
+				}
+				INSTRUMENT_COUNT(filter_items_scanned, items.size());
+				INSTRUMENT_COUNT(filter_matches, result.size());
+				return result;
+			}
+
+			// the same with a plain predicate - no Specification object and no virtual call per item
+			vector<Product*> filter(const vector<Product*>& items, function_ref<bool(Product*)> predicate)
+			{
+				INSTRUMENT_SPAN("BetterFilter::filter predicate");
 				vector<Product*> result;
 				for (auto& p : items)
-					if (spec.is_satisfied(p))
+					if (predicate(p))
 						result.push_back(p);
+				INSTRUMENT_COUNT(filter_items_scanned, items.size());
+				INSTRUMENT_COUNT(filter_matches, result.size());
 				return result;
 			}
 		};
@@ -110,6 +174,20 @@ namespace Solid
 			}
 		};
 
+		// any lambda can become a specification, its captures are stored inside the object (no heap allocation)
+		template <typename T> struct LambdaSpecification : Specification<T>
+		{
+			inline_function<bool(T*)> predicate;
+
+			explicit LambdaSpecification(inline_function<bool(T*)> predicate)
+				: predicate{ move(predicate) } {}
+
+			bool is_satisfied(T* item) const override
+			{
+				return predicate(item);
+			}
+		};
+
 		template <typename T> struct AndSpecification : Specification<T>
 		{
 			const Specification<T>& first;
@@ -124,6 +202,79 @@ namespace Solid
 			}
 		};
 
+		// questions about the whole catalog answered in one pass, without a vector of all the matches
+		// the specification is only read, but from several threads at once - it must not change its own state
+		struct ProductAggregator
+		{
+			using GroupCounts = array<array<size_t, size_count>, color_count>;
+
+			// how many matching products there are for every combination of color and size
+			// every thread counts its part into its own array (on its own cache line) and the arrays are added at the end
+			GroupCounts count_by_color_and_size(const vector<Product*>& items, const Specification<Product>& spec,
+				unsigned thread_count = thread::hardware_concurrency())
+			{
+				INSTRUMENT_SPAN("ProductAggregator::count_by_color_and_size");
+
+				struct alignas(cache_line_size) PartialCounts
+				{
+					GroupCounts counts{};
+				};
+
+				vector<PartialCounts> partial(Parallel::thread_count_for(items.size(), thread_count));
+				Parallel::for_each_chunk(items.size(), thread_count, [&](const unsigned t, const size_t begin, const size_t end)
+				{
+					GroupCounts& counts = partial[t].counts;
+					for (size_t i = begin; i < end; i++)
+						if (spec.is_satisfied(items[i]))
+							counts[size_t(items[i]->color)][size_t(items[i]->size)]++;
+				});
+
+				GroupCounts result{};
+				for (const auto& p : partial)
+					for (size_t color = 0; color < color_count; color++)
+						for (size_t size = 0; size < size_count; size++)
+							result[color][size] += p.counts[color][size];
+				return result;
+			}
+
+			// the first k matching products ordered by name
+			// only the k best candidates are kept (the worst of them on top of a max-heap), memory stays O(k)
+			// however many products match
+			vector<Product*> top_k_by_name(const vector<Product*>& items, const Specification<Product>& spec, const size_t k)
+			{
+				INSTRUMENT_SPAN("ProductAggregator::top_k_by_name");
+
+				auto by_name = [](const Product* a, const Product* b) { return a->name < b->name; };
+				vector<Product*> heap;
+				if (k == 0)
+					return heap;
+				heap.reserve(k);
+
+				for (auto* p : items)
+				{
+					if (heap.size() == k && !by_name(p, heap.front()))
+						continue; // cheaper than the specification, most products lose to the current k
+					if (!spec.is_satisfied(p))
+						continue;
+
+					if (heap.size() < k)
+					{
+						heap.push_back(p);
+						push_heap(heap.begin(), heap.end(), by_name);
+					}
+					else
+					{
+						pop_heap(heap.begin(), heap.end(), by_name);
+						heap.back() = p;
+						push_heap(heap.begin(), heap.end(), by_name);
+					}
+				}
+
+				sort_heap(heap.begin(), heap.end(), by_name);
+				return heap;
+			}
+		};
+
 	public:
 		void open_closed_principle_demo()
 		{
@@ -149,10 +300,175 @@ namespace Solid
 			for (auto& x : bf.filter(all, spec))
 				cout << x->name << " is green and large\n";
 
+			// a predicate passed directly
+			const string wanted = "Tree";
+			for (auto& x : bf.filter(all, [&wanted](Product* p) { return p->name == wanted; }))
+				cout << x->name << " found by name\n";
+
+			// or the same predicate as a specification that can be combined with others
+			LambdaSpecification<Product> named_tree([&wanted](Product* p) { return p->name == wanted; });
+			auto named_tree_and_large = named_tree && large;
+			for (auto& x : bf.filter(all, named_tree_and_large))
+				cout << x->name << " is a large tree\n";
+
+			// aggregations over the matching products
+			ProductAggregator aggregator;
+			const auto counts = aggregator.count_by_color_and_size(all, large);
+			cout << counts[size_t(Color::green)][size_t(Size::large)] << " green and large, "
+				<< counts[size_t(Color::blue)][size_t(Size::large)] << " blue and large\n";
+			for (auto& x : aggregator.top_k_by_name(all, large, 1))
+				cout << x->name << " is the first large thing by name\n";
+
 			// warning: the following will compile but will NOT work
 			//auto spec2 = SizeSpecification{Size::large}
 			//	&& ColorSpecification{Color::blue};
 		}
+
+		// random products, the same seed gives the same catalog
+		static vector<Product> make_products(const size_t count, const unsigned seed)
+		{
+			mt19937 random{ seed };
+			uniform_int_distribution<int> value{ 0, 2 };
+
+			vector<Product> products;
+			products.reserve(count);
+			for (size_t i = 0; i < count; i++)
+				products.push_back({ "product " + to_string(i), Color(value(random)), Size(value(random)) });
+			return products;
+		}
+
+		// the old filter with a method per criterion against specifications, simple and composed
+		void open_closed_principle_benchmark(const size_t product_count = 100000, const unsigned seed = 42)
+		{
+			vector<Product> products = make_products(product_count, seed);
+			vector<Product*> all;
+			for (auto& p : products)
+				all.push_back(&p);
+
+			size_t found = 0;
+			ProductFilter pf;
+			Benchmark::report("ProductFilter::by_color", Benchmark::measure([&] { found = pf.by_color(all, Color::green).size(); }), product_count);
+			Benchmark::report("ProductFilter::by_size_and_color", Benchmark::measure([&]
+			{
+				found = pf.by_size_and_color(all, Size::large, Color::green).size();
+			}), product_count);
+
+			BetterFilter bf;
+			ColorSpecification green(Color::green);
+			SizeSpecification large(Size::large);
+			Benchmark::report("BetterFilter, color", Benchmark::measure([&] { found = bf.filter(all, green).size(); }), product_count);
+
+			auto green_and_large = green && large;
+			Benchmark::report("BetterFilter, color && size", Benchmark::measure([&]
+			{
+				found = bf.filter(all, green_and_large).size();
+			}), product_count);
+
+			LambdaSpecification<Product> short_name([](Product* p) { return p->name.size() < 11; });
+			AndSpecification<Product> three_specs(green_and_large, short_name);
+			Benchmark::report("BetterFilter, color && size && name", Benchmark::measure([&]
+			{
+				found = bf.filter(all, three_specs).size();
+			}), product_count);
+
+			Benchmark::report("BetterFilter, predicate", Benchmark::measure([&]
+			{
+				found = bf.filter(all, [](Product* p) { return p->color == Color::green && p->size == Size::large; }).size();
+			}), product_count);
+			Benchmark::do_not_optimize(found);
+		}
+
+		// filtering everything and then counting or sorting against the aggregations
+		void open_closed_principle_aggregation_benchmark(const size_t product_count = 1'000'000, const unsigned seed = 42)
+		{
+			vector<Product> products = make_products(product_count, seed);
+			vector<Product*> all;
+			for (auto& p : products)
+				all.push_back(&p);
+
+			BetterFilter bf;
+			ProductAggregator aggregator;
+			LambdaSpecification<Product> not_small([](Product* p) { return p->size != Size::small; });
+			const size_t k = 10;
+
+			ProductAggregator::GroupCounts expected{}, counts{};
+			Benchmark::report("group by, filter then count", Benchmark::measure([&]
+			{
+				expected = {};
+				for (auto* p : bf.filter(all, not_small))
+					expected[size_t(p->color)][size_t(p->size)]++;
+			}), product_count);
+
+			Benchmark::report("group by, count_by_color_and_size (1 thread)", Benchmark::measure([&]
+			{
+				counts = aggregator.count_by_color_and_size(all, not_small, 1);
+			}), product_count);
+			if (counts != expected)
+				cout << "count_by_color_and_size differs from filter then count" << endl;
+
+			Benchmark::report("group by, count_by_color_and_size (all threads)", Benchmark::measure([&]
+			{
+				counts = aggregator.count_by_color_and_size(all, not_small);
+			}), product_count);
+			if (counts != expected)
+				cout << "count_by_color_and_size differs from filter then count" << endl;
+
+			auto by_name = [](const Product* a, const Product* b) { return a->name < b->name; };
+			vector<Product*> sorted, partially_sorted, top;
+			Benchmark::report("top 10, filter then sort", Benchmark::measure([&]
+			{
+				sorted = bf.filter(all, not_small);
+				sort(sorted.begin(), sorted.end(), by_name);
+				sorted.resize(min(k, sorted.size()));
+			}, 1), product_count);
+
+			Benchmark::report("top 10, filter then partial_sort", Benchmark::measure([&]
+			{
+				partially_sorted = bf.filter(all, not_small);
+				const size_t count = min(k, partially_sorted.size());
+				partial_sort(partially_sorted.begin(), partially_sorted.begin() + count, partially_sorted.end(), by_name);
+				partially_sorted.resize(count);
+			}), product_count);
+
+			Benchmark::report("top 10, top_k_by_name", Benchmark::measure([&]
+			{
+				top = aggregator.top_k_by_name(all, not_small, k);
+			}), product_count);
+			if (top != sorted || partially_sorted != sorted)
+				cout << "top_k_by_name differs from filter then sort" << endl;
+		}
+
+		// many small filter results, every one of them allocated and freed
+		void open_closed_principle_memory_benchmark(const size_t product_count = 1000, const int query_count = 20000)
+		{
+			vector<Product> products;
+			for (size_t i = 0; i < product_count; i++)
+				products.push_back({ "product", Color(i % 3), Size(i / 3 % 3) });
+			vector<Product*> all;
+			for (auto& p : products)
+				all.push_back(&p);
+
+			BetterFilter bf;
+			ColorSpecification green(Color::green);
+			SizeSpecification large(Size::large);
+			auto spec = green && large;
+
+			auto run = [&](pmr::memory_resource* resource)
+			{
+				size_t found = 0;
+				for (int i = 0; i < query_count; i++)
+					found += bf.filter(all, spec, resource).size();
+				Benchmark::do_not_optimize(found);
+			};
+
+			CountingResource heap;
+			Benchmark::report("filter, global heap", Benchmark::measure([&] { run(&heap); }), query_count);
+			heap.get_statistics().print("global heap");
+
+			PoolResource pool;
+			Benchmark::report("filter, pool", Benchmark::measure([&] { run(&pool); }), query_count);
+			pool.get_statistics().print("pool");
+		}
 	};
 
 	class LiskovsSubstitutionPrinciple
@@ -203,6 +519,29 @@ namespace Solid
 				<< ", got " << r.area() << std::endl;
 		}
 
+		// bridge between the object world and the batch world
+		// the kind has to be known at the moment of copying, afterwards no virtual calls are needed
+		static void add_to_batch(ShapeBatch& batch, const Rectangle& r)
+		{
+			if (dynamic_cast<const Square*>(&r))
+				batch.add_square(r.get_width());
+			else
+				batch.add_rectangle(r.get_width(), r.get_height());
+		}
+
+		// writes the batch state back to the object, the object has to be of the same kind
+		static void store_from_batch(const ShapeBatch& batch, const size_t index, Rectangle& r)
+		{
+			r.set_width(batch.get_width(index));
+			r.set_height(batch.get_height(index));
+		}
+
+		// the same as process() but for all the shapes at once
+		void process(ShapeBatch& batch)
+		{
+			batch.set_height(10);
+		}
+
 	public:
 		void liskovs_substitution_principle_demo()
 		{
@@ -212,15 +551,112 @@ namespace Solid
 			Square s{ 5 };
 			process(s);
 
+			// batch version - squares still behave like squares
+			ShapeBatch batch;
+			add_to_batch(batch, r);
+			add_to_batch(batch, s);
+			process(batch);
+			for (size_t i = 0; i < batch.size(); i++)
+				std::cout << "batch shape " << i << " area = "
+					<< batch.get_width(i) * batch.get_height(i) << std::endl;
+
 			getchar();
 		}
+
+		// per-object virtual calls versus one bulk operation over the whole batch
+		void liskovs_substitution_principle_benchmark(const size_t shape_count = 4'000'000)
+		{
+			vector<unique_ptr<Rectangle>> shapes;
+			ShapeBatch batch;
+			shapes.reserve(shape_count);
+			batch.reserve(shape_count);
+			for (size_t i = 0; i < shape_count; i++)
+			{
+				const int size = 1 + static_cast<int>(i % 100);
+				if (i % 2)
+					shapes.push_back(make_unique<Square>(size));
+				else
+					shapes.push_back(make_unique<Rectangle>(size, size + 1));
+				add_to_batch(batch, *shapes.back());
+			}
+
+			long long total = 0, batch_total = 0;
+			const auto per_object = Benchmark::measure([&]
+			{
+				total = 0;
+				for (auto& shape : shapes)
+				{
+					shape->set_height(10);
+					total += shape->area();
+				}
+			});
+			Benchmark::do_not_optimize(total);
+			Benchmark::report("virtual set_height + area", per_object, shape_count);
+
+			const auto batched = Benchmark::measure([&]
+			{
+				batch.set_height(10);
+				batch_total = batch.total_area();
+			});
+			Benchmark::do_not_optimize(batch_total);
+			Benchmark::report("ShapeBatch set_height + total_area", batched, shape_count);
+			if (batch_total != total)
+				cout << "ShapeBatch total_area differs from the virtual calls after set_height" << endl;
+
+			// set_width + set_height + scale + the area of every shape
+			// the sides are read before scaling, a square would otherwise scale the side set_width already scaled
+			vector<int> areas(shape_count), batch_areas;
+			const auto per_object_bulk = Benchmark::measure([&]
+			{
+				for (size_t i = 0; i < shapes.size(); i++)
+				{
+					auto& shape = *shapes[i];
+					shape.set_width(7);
+					shape.set_height(5);
+					const int width = shape.get_width(), height = shape.get_height();
+					shape.set_width(width * 2);
+					shape.set_height(height * 2);
+					areas[i] = shape.area();
+				}
+			});
+			Benchmark::do_not_optimize(areas);
+			Benchmark::report("virtual resize + scale + area", per_object_bulk, shape_count);
+
+			const auto batched_bulk = Benchmark::measure([&]
+			{
+				batch.resize(7, 5);
+				batch.scale(2);
+				batch.area(batch_areas);
+			});
+			Benchmark::do_not_optimize(batch_areas);
+			Benchmark::report("ShapeBatch resize + scale + area", batched_bulk, shape_count);
+			if (batch_areas != areas)
+				cout << "ShapeBatch area differs from the virtual calls after resize and scale" << endl;
+
+			// back to the objects, every one of them has to end up with the sides the batch has
+			size_t mismatches = 0;
+			for (size_t i = 0; i < shapes.size(); i++)
+			{
+				store_from_batch(batch, i, *shapes[i]);
+				mismatches += shapes[i]->get_width() != batch.get_width(i) || shapes[i]->get_height() != batch.get_height(i);
+			}
+			if (mismatches)
+				cout << "store_from_batch left " << mismatches << " shapes different from the batch" << endl;
+		}
 	};
 
 	// break up the interface into smaller interfaces so all the method are always needed
 	// in need we can always combine smaller interfaces into a bigger one
 	class InterfaceSegregationPrinciple
 	{
-		struct Document;
+		struct Document
+		{
+			string name;
+			vector<char> content;
+
+			// when the document entered the machine, used to measure the end-to-end latency
+			chrono::steady_clock::time_point submitted;
+		};
 
 		// this interface is just too big
 		struct IMachine
@@ -255,6 +691,11 @@ namespace Solid
 			virtual void scan(Document& doc) = 0;
 		};
 
+		struct IFax
+		{
+			virtual void fax(Document& doc) = 0;
+		};
+
 		struct Printer : IPrinter
 		{
 			void print(Document& doc) override;
@@ -287,12 +728,397 @@ namespace Solid
 			void scan(Document& doc) override;
 		};
 
+		// stand-in devices, they only pretend to work by waiting for the configured time
+		static void simulate_work(const chrono::microseconds latency)
+		{
+			if (latency.count() > 0)
+				this_thread::sleep_for(latency);
+		}
+
+		struct SimulatedScanner : IScanner
+		{
+			chrono::microseconds latency;
+			size_t page_bytes;
+
+			SimulatedScanner(const chrono::microseconds latency, const size_t page_bytes)
+				: latency{ latency }, page_bytes{ page_bytes } { }
+
+			void scan(Document& doc) override
+			{
+				doc.content.resize(page_bytes);
+				simulate_work(latency);
+			}
+		};
+
+		struct SimulatedFax : IFax
+		{
+			chrono::microseconds latency;
+			size_t sent_bytes = 0;
+
+			explicit SimulatedFax(const chrono::microseconds latency) : latency{ latency } { }
+
+			void fax(Document& doc) override
+			{
+				sent_bytes += doc.content.size();
+				simulate_work(latency);
+			}
+		};
+
+		struct SimulatedPrinter : IPrinter
+		{
+			chrono::microseconds latency;
+			size_t printed_bytes = 0;
+
+			explicit SimulatedPrinter(const chrono::microseconds latency) : latency{ latency } { }
+
+			void print(Document& doc) override
+			{
+				printed_bytes += doc.content.size();
+				simulate_work(latency);
+			}
+		};
+
+		// pipeline mode - every device works on its own thread, scanner -> (fax) -> printer
+		// while the printer prints the first document the scanner already scans the next one
+		// so the throughput is limited by the slowest stage and not by the sum of all of them
+		// documents travel between the stages as unique_ptr so the content is never copied
+		// queues are bounded, when the printer cannot keep up the scanner has to wait (backpressure)
+		class PipelineMachine
+		{
+			using DocumentPtr = unique_ptr<Document>;
+
+			IScanner& scanner;
+			IFax* fax; // optional
+			IPrinter& printer;
+
+			MpmcQueue<DocumentPtr> submitted; // any thread can submit a document
+			SpscQueue<DocumentPtr> scanned;
+			SpscQueue<DocumentPtr> faxed;
+
+			// each histogram is written only by its own stage thread
+			// and can be read after finish() has joined the threads
+			LatencyHistogram scan_latency, fax_latency, print_latency, total_latency;
+			size_t completed = 0;
+			chrono::steady_clock::time_point started, finished;
+
+			vector<thread> stages;
+
+			// a null document is the signal that there will be no more work
+			template <typename In, typename Out, typename Work>
+			static void run_stage(In& in, Out& out, LatencyHistogram& histogram, Work work)
+			{
+				for (;;)
+				{
+					DocumentPtr doc = in.pop();
+					if (!doc)
+					{
+						out.push(nullptr);
+						return;
+					}
+
+					const auto start = chrono::steady_clock::now();
+					work(*doc);
+					histogram.record(chrono::steady_clock::now() - start);
+					out.push(move(doc));
+				}
+			}
+
+			void run_printer()
+			{
+				while (DocumentPtr doc = faxed.pop())
+				{
+					const auto start = chrono::steady_clock::now();
+					printer.print(*doc);
+					const auto end = chrono::steady_clock::now();
+
+					print_latency.record(end - start);
+					total_latency.record(end - doc->submitted);
+					completed++;
+				}
+			}
+
+		public:
+			PipelineMachine(IScanner& scanner, IFax* fax, IPrinter& printer, const size_t queue_capacity = 16)
+				: scanner{ scanner }, fax{ fax }, printer{ printer },
+				submitted{ queue_capacity }, scanned{ queue_capacity }, faxed{ queue_capacity },
+				started{ chrono::steady_clock::now() }
+			{
+				// without a fax the scanner feeds the printer directly
+				auto& scanner_output = fax ? scanned : faxed;
+				stages.emplace_back([this, &scanner_output]
+				{
+					run_stage(submitted, scanner_output, scan_latency, [this](Document& doc) { this->scanner.scan(doc); });
+				});
+
+				if (fax)
+					stages.emplace_back([this]
+					{
+						run_stage(scanned, faxed, fax_latency, [this](Document& doc) { this->fax->fax(doc); });
+					});
+
+				stages.emplace_back([this] { run_printer(); });
+			}
+
+			PipelineMachine(const PipelineMachine&) = delete;
+			PipelineMachine& operator=(const PipelineMachine&) = delete;
+
+			~PipelineMachine() { finish(); }
+
+			// blocks when the machine is already full of work
+			void submit(DocumentPtr doc)
+			{
+				doc->submitted = chrono::steady_clock::now();
+				submitted.push(move(doc));
+			}
+
+			// waits until all the submitted documents are printed
+			void finish()
+			{
+				if (stages.empty())
+					return;
+
+				submitted.push(nullptr);
+				for (auto& stage : stages)
+					stage.join();
+				stages.clear();
+				finished = chrono::steady_clock::now();
+			}
+
+			void print_statistics() const
+			{
+				const double seconds = chrono::duration<double>(finished - started).count();
+				cout << completed << " documents in " << seconds << " s, "
+					<< completed / seconds << " documents/s" << endl;
+
+				scan_latency.print("scan");
+				if (fax)
+					fax_latency.print("fax");
+				print_latency.print("print");
+				total_latency.print("submit to printed");
+			}
+		};
+
+		// a device that accepts many documents at once, the cost of starting a job is paid once per batch
+		struct IBatchPrinter
+		{
+			virtual void print_batch(Document* const* docs, size_t count) = 0;
+		};
+
+		// stand-in device that appends documents to a file, one flush per batch
+		struct FilePrinter : IBatchPrinter
+		{
+			ofstream file;
+			chrono::microseconds job_overhead;
+
+			FilePrinter(const string& path, const chrono::microseconds job_overhead)
+				: file{ path, ios::binary }, job_overhead{ job_overhead } { }
+
+			void print_batch(Document* const* docs, const size_t count) override
+			{
+				simulate_work(job_overhead);
+				for (size_t i = 0; i < count; i++)
+					file.write(docs[i]->content.data(), docs[i]->content.size());
+				file.flush();
+			}
+		};
+
+		// print() does not talk to the device, it only copies the document into a pooled buffer and queues it
+		// a background thread collects queued documents into a batch and sends the batch to the device when
+		// - the batch is big enough (max_batch_jobs or max_batch_bytes) or
+		// - the oldest document in the batch has waited max_delay (so the latency stays bounded)
+		// buffers return to the pool after printing so in the steady state nothing is allocated
+		class PrintSpooler : public IPrinter
+		{
+			using DocumentPtr = unique_ptr<Document>;
+
+			IBatchPrinter& device;
+			const size_t max_batch_jobs;
+			const size_t max_batch_bytes;
+			const chrono::steady_clock::duration max_delay;
+
+			ObjectPool<Document> pool;
+			MpmcQueue<DocumentPtr> jobs;
+
+			atomic<size_t> submitted_jobs{ 0 };
+			atomic<size_t> printed_jobs{ 0 };
+			atomic<size_t> printed_batches{ 0 };
+			atomic<size_t> max_queue_depth{ 0 };
+			atomic<bool> stopping{ false };
+			Parking wakeup; // the idle worker sleeps here, print() and stop() wake it up
+
+			// written only by the spooler thread, readable after stop()
+			LatencyHistogram job_latency;
+
+			thread worker;
+
+			void flush(vector<DocumentPtr>& batch, vector<Document*>& raw)
+			{
+				raw.clear();
+				for (auto& doc : batch)
+					raw.push_back(doc.get());
+				device.print_batch(raw.data(), raw.size());
+
+				const auto now = chrono::steady_clock::now();
+				for (auto& doc : batch)
+				{
+					job_latency.record(now - doc->submitted);
+					pool.release(move(doc));
+				}
+
+				printed_jobs.fetch_add(batch.size(), memory_order_relaxed);
+				printed_batches.fetch_add(1, memory_order_relaxed);
+				batch.clear();
+			}
+
+			void run()
+			{
+				vector<DocumentPtr> batch;
+				vector<Document*> raw;
+				batch.reserve(max_batch_jobs);
+				raw.reserve(max_batch_jobs);
+				size_t batch_bytes = 0;
+				auto has_work = [this] { return jobs.size() != 0 || stopping.load(memory_order_acquire); };
+
+				for (;;)
+				{
+					DocumentPtr doc;
+					if (jobs.try_pop(doc))
+					{
+						batch_bytes += doc->content.size();
+						batch.push_back(move(doc));
+						if (batch.size() >= max_batch_jobs || batch_bytes >= max_batch_bytes)
+						{
+							flush(batch, raw);
+							batch_bytes = 0;
+						}
+						continue;
+					}
+
+					// nothing new arrived, check whether the oldest job has waited long enough
+					if (!batch.empty() && chrono::steady_clock::now() - batch.front()->submitted >= max_delay)
+					{
+						flush(batch, raw);
+						batch_bytes = 0;
+					}
+					else if (stopping.load(memory_order_acquire) && jobs.size() == 0)
+					{
+						if (!batch.empty())
+							flush(batch, raw);
+						return;
+					}
+					// sleep until a job or stop() arrives, with a batch pending at the latest until its deadline
+					else if (batch.empty())
+						wakeup.wait(has_work);
+					else
+						wakeup.wait_until(batch.front()->submitted + max_delay, has_work);
+				}
+			}
+
+		public:
+			PrintSpooler(IBatchPrinter& device, const size_t max_batch_jobs, const size_t max_batch_bytes,
+				const chrono::microseconds max_delay, const size_t pool_size = 256, const size_t document_bytes = 4096)
+				: device{ device }, max_batch_jobs{ max_batch_jobs }, max_batch_bytes{ max_batch_bytes }, max_delay{ max_delay },
+				pool{ pool_size, [document_bytes](Document& doc) { doc.content.reserve(document_bytes); } },
+				jobs{ pool_size }
+			{
+				worker = thread([this] { run(); });
+			}
+
+			PrintSpooler(const PrintSpooler&) = delete;
+			PrintSpooler& operator=(const PrintSpooler&) = delete;
+
+			~PrintSpooler() { stop(); }
+
+			// blocks only when all pooled buffers are waiting to be printed
+			void print(Document& doc) override
+			{
+				DocumentPtr job = pool.acquire();
+				job->name = doc.name;
+				job->content.assign(doc.content.begin(), doc.content.end());
+				job->submitted = chrono::steady_clock::now();
+				jobs.push(move(job));
+				wakeup.notify();
+
+				submitted_jobs.fetch_add(1, memory_order_relaxed);
+				const size_t depth = jobs.size();
+				size_t max_depth = max_queue_depth.load(memory_order_relaxed);
+				while (depth > max_depth && !max_queue_depth.compare_exchange_weak(max_depth, depth, memory_order_relaxed)) { }
+			}
+
+			// prints everything that is still queued and stops the background thread
+			void stop()
+			{
+				if (!worker.joinable())
+					return;
+				stopping.store(true, memory_order_release);
+				wakeup.notify();
+				worker.join();
+			}
+
+			size_t get_queue_depth() const { return jobs.size(); }
+			size_t get_max_queue_depth() const { return max_queue_depth.load(memory_order_relaxed); }
+			size_t get_submitted_jobs() const { return submitted_jobs.load(memory_order_relaxed); }
+			size_t get_printed_jobs() const { return printed_jobs.load(memory_order_relaxed); }
+			size_t get_printed_batches() const { return printed_batches.load(memory_order_relaxed); }
+			const LatencyHistogram& get_job_latency() const { return job_latency; }
+		};
+
 	public:
 		void interface_segregation_principle_demo()
 		{
 			// nothing to show check the code
 			getchar();
 		}
+
+		// the same documents processed one after another and by the pipeline
+		void interface_segregation_principle_benchmark(const size_t document_count = 2000)
+		{
+			SimulatedScanner scanner{ chrono::microseconds(100), 4096 };
+			SimulatedFax fax{ chrono::microseconds(50) };
+			SimulatedPrinter printer{ chrono::microseconds(200) };
+
+			const auto sequential = Benchmark::measure([&]
+			{
+				for (size_t i = 0; i < document_count; i++)
+				{
+					Document doc;
+					scanner.scan(doc);
+					fax.fax(doc);
+					printer.print(doc);
+				}
+			}, 1);
+			Benchmark::report("sequential scan + fax + print", sequential, document_count);
+
+			PipelineMachine machine{ scanner, &fax, printer };
+			for (size_t i = 0; i < document_count; i++)
+				machine.submit(make_unique<Document>());
+			machine.finish();
+			machine.print_statistics();
+		}
+
+		// the same stream of small documents printed through spoolers with different batch sizes
+		void print_spooler_benchmark(const size_t document_count = 20000)
+		{
+			Document doc{ "page", vector<char>(512, 'x'), {} };
+
+			for (const size_t batch_jobs : { 1, 8, 64 })
+			{
+				FilePrinter device{ "spooler_benchmark.bin", chrono::microseconds(20) };
+				PrintSpooler spooler{ device, batch_jobs, 64 * 1024, chrono::microseconds(500) };
+
+				const auto elapsed = Benchmark::measure([&]
+				{
+					for (size_t i = 0; i < document_count; i++)
+						spooler.print(doc);
+					spooler.stop();
+				}, 1);
+
+				Benchmark::report("spooler, batches of " + to_string(batch_jobs), elapsed, document_count);
+				cout << spooler.get_printed_batches() << " batches, max queue depth " << spooler.get_max_queue_depth() << endl;
+				spooler.get_job_latency().print("job latency");
+			}
+			remove("spooler_benchmark.bin");
+		}
 	};
 
 	// its split into two ideas
@@ -315,7 +1141,21 @@ namespace Solid
 
 		struct Person
 		{
-			string name;
+			// the name can live in any memory resource, containers of people pass their own one down
+			using allocator_type = pmr::polymorphic_allocator<char>;
+
+			pmr::string name;
+
+			Person(string_view name = {}, const allocator_type& allocator = {})
+				: name(name, allocator) { }
+			Person(const Person& other, const allocator_type& allocator)
+				: name(other.name, allocator) { }
+			Person(Person&& other, const allocator_type& allocator)
+				: name(move(other.name), allocator) { }
+			Person(const Person&) = default;
+			Person(Person&&) = default;
+			Person& operator=(const Person&) = default;
+			Person& operator=(Person&&) = default;
 		};
 
 		// let's introduce an abstraction
@@ -327,26 +1167,241 @@ namespace Solid
 		// data is low level
 		struct Relationships : RelationshipBrowser // low-level
 		{
-			vector<tuple<Person, Relationship, Person>> relations;
+			pmr::vector<tuple<Person, Relationship, Person>> relations;
+
+			// everything stored here (including the names) comes from the resource
+			explicit Relationships(pmr::memory_resource* resource = pmr::get_default_resource())
+				: relations{ resource } { }
 
 			void add_parent_and_child(const Person& parent, const Person& child)
 			{
-				relations.push_back({ parent, Relationship::parent, child });
-				relations.push_back({ child, Relationship::child, parent });
+				relations.emplace_back(parent, Relationship::parent, child);
+				relations.emplace_back(child, Relationship::child, parent);
 			}
 
 			vector<Person> find_all_children_of(const string &name) override
 			{
+				INSTRUMENT_SPAN("Relationships::find_all_children_of");
+				INSTRUMENT_COUNT(relations_scanned, relations.size());
 				vector<Person> result;
 
 				for (auto&&[first, rel, second] : relations)
-					if (first.name == name && rel == Relationship::parent)
+					if (string_view{ first.name } == name && rel == Relationship::parent)
+						result.push_back(second);
+
+				return result;
+			}
+
+			pmr::vector<Person> find_all_children_of(const string& name, pmr::memory_resource* resource)
+			{
+				INSTRUMENT_SPAN("Relationships::find_all_children_of");
+				INSTRUMENT_COUNT(relations_scanned, relations.size());
+				pmr::vector<Person> result{ resource };
+
+				for (auto&& [first, rel, second] : relations)
+					if (string_view{ first.name } == name && rel == Relationship::parent)
 						result.push_back(second);
 
 				return result;
 			}
 		};
 
+		// the same browser for a service where many threads ask and a few threads add at the same time
+		// every parent has its own list of children in a hash map, so a lookup does not scan all the relations
+		//	- readers never lock and never retry, they follow pointers published with release stores (wait-free)
+		//	- writers lock one of the shards the buckets are split into, writers of other shards and all readers go on
+		//	- nothing is ever removed, so a reader can never see memory that was freed under its hands
+		// the children of a parent are stored in chunks, every chunk twice as big as the previous one
+		// a new child is constructed first and only then made visible by increasing the count of its chunk
+		// when there are more people than buckets the table is rebuilt twice as big (with all the shards locked)
+		// and swapped in, readers still walking the old table finish there - old tables are kept until the end
+		class ConcurrentRelationships : public RelationshipBrowser
+		{
+			struct Chunk
+			{
+				Chunk* const previous;
+				const uint32_t capacity;
+				atomic<uint32_t> count{ 0 };
+				Person* const children;
+
+				Chunk(Chunk* previous, const uint32_t capacity)
+					: previous{ previous }, capacity{ capacity }, children{ allocator<Person>{}.allocate(capacity) } { }
+
+				~Chunk()
+				{
+					destroy(children, children + count.load(memory_order_relaxed));
+					allocator<Person>{}.deallocate(children, capacity);
+				}
+			};
+
+			struct Entry
+			{
+				const string name;
+				const size_t hash;
+				atomic<Chunk*> children{ nullptr };
+
+				Entry(string_view name, const size_t hash) : name{ name }, hash{ hash } { }
+			};
+
+			// entries are shared by all the tables, every table links them with its own nodes
+			struct Node
+			{
+				Entry* const entry;
+				Node* const next;
+			};
+
+			struct Table
+			{
+				vector<atomic<Node*>> buckets;
+				const size_t mask;
+				Table* const previous;
+
+				Table(const size_t size, Table* previous) : buckets(size), mask{ size - 1 }, previous{ previous } { }
+			};
+
+			struct alignas(cache_line_size) Shard
+			{
+				mutex writer;
+			};
+
+			static constexpr size_t shard_count = 64;
+			static constexpr uint32_t first_chunk_capacity = 4;
+
+			// a table has at least as many buckets as there are shards, so every bucket belongs to exactly one shard
+			atomic<Table*> table;
+			atomic<size_t> people{ 0 };
+			array<Shard, shard_count> shards;
+
+			static Entry* find(const Table& table, const string_view name, const size_t hash)
+			{
+				for (Node* n = table.buckets[hash & table.mask].load(memory_order_acquire); n; n = n->next)
+					if (n->entry->hash == hash && n->entry->name == name)
+						return n->entry;
+				return nullptr;
+			}
+
+			static void link(Table& table, Entry* entry)
+			{
+				auto& bucket = table.buckets[entry->hash & table.mask];
+				bucket.store(new Node{ entry, bucket.load(memory_order_relaxed) }, memory_order_release);
+			}
+
+			// the oldest chunk first, so the children come in the order they were added
+			// chunks double in size, so the recursion is at most a few dozen levels deep
+			template <typename Visit> static void visit(const Chunk* chunk, Visit& visitor)
+			{
+				if (!chunk)
+					return;
+				visit(chunk->previous, visitor);
+				const uint32_t count = chunk->count.load(memory_order_acquire);
+				for (uint32_t i = 0; i < count; i++)
+					visitor(chunk->children[i]);
+			}
+
+			// all the shards are locked (always in the same order), so no writer touches the table while it is copied
+			void grow()
+			{
+				array<unique_lock<mutex>, shard_count> locks;
+				for (size_t i = 0; i < shard_count; i++)
+					locks[i] = unique_lock<mutex>{ shards[i].writer };
+
+				Table* old = table.load(memory_order_relaxed);
+				if (people.load(memory_order_relaxed) <= old->buckets.size())
+					return; // somebody else was faster
+
+				auto* bigger = new Table{ old->buckets.size() * 2, old };
+				for (auto& bucket : old->buckets)
+					for (Node* n = bucket.load(memory_order_relaxed); n; n = n->next)
+						link(*bigger, n->entry);
+				table.store(bigger, memory_order_release);
+			}
+
+		public:
+			explicit ConcurrentRelationships(const size_t expected_people = 1024)
+				: table{ new Table{ round_up_to_power_of_two(max(expected_people, shard_count)), nullptr } } { }
+
+			ConcurrentRelationships(const ConcurrentRelationships&) = delete;
+			ConcurrentRelationships& operator=(const ConcurrentRelationships&) = delete;
+
+			~ConcurrentRelationships()
+			{
+				// the newest table links every entry once
+				Table* current = table.load(memory_order_relaxed);
+				for (auto& bucket : current->buckets)
+					for (Node* n = bucket.load(memory_order_relaxed); n; n = n->next)
+					{
+						for (Chunk* c = n->entry->children.load(memory_order_relaxed); c;)
+							delete exchange(c, c->previous);
+						delete n->entry;
+					}
+
+				for (Table* t = current; t;)
+				{
+					for (auto& bucket : t->buckets)
+						for (Node* n = bucket.load(memory_order_relaxed); n;)
+							delete exchange(n, n->next);
+					delete exchange(t, t->previous);
+				}
+			}
+
+			void add_parent_and_child(const Person& parent, const Person& child)
+			{
+				const string_view name{ parent.name };
+				const size_t hash = std::hash<string_view>{}(name);
+				bool too_full = false;
+
+				{
+					// a bucket always belongs to the same shard, so its list is changed only under this lock
+					lock_guard<mutex> lock{ shards[hash % shard_count].writer };
+					Table& current = *table.load(memory_order_acquire);
+
+					Entry* entry = find(current, name, hash);
+					if (!entry)
+					{
+						entry = new Entry{ name, hash };
+						link(current, entry);
+						too_full = people.fetch_add(1, memory_order_relaxed) + 1 > current.buckets.size();
+					}
+
+					Chunk* chunk = entry->children.load(memory_order_relaxed);
+					if (chunk && chunk->count.load(memory_order_relaxed) < chunk->capacity)
+					{
+						const uint32_t count = chunk->count.load(memory_order_relaxed);
+						::new (static_cast<void*>(chunk->children + count)) Person(child);
+						chunk->count.store(count + 1, memory_order_release);
+					}
+					else
+					{
+						auto* next = new Chunk{ chunk, chunk ? chunk->capacity * 2 : first_chunk_capacity };
+						::new (static_cast<void*>(next->children)) Person(child);
+						next->count.store(1, memory_order_relaxed);
+						entry->children.store(next, memory_order_release);
+					}
+				}
+
+				// more people than buckets, the lists would only get longer
+				if (too_full)
+					grow();
+			}
+
+			// calls the visitor for every child without allocating anything
+			template <typename Visit> void for_each_child_of(const string_view name, Visit&& visitor) const
+			{
+				const Table& current = *table.load(memory_order_acquire);
+				if (const Entry* entry = find(current, name, std::hash<string_view>{}(name)))
+					visit(entry->children.load(memory_order_acquire), visitor);
+			}
+
+			vector<Person> find_all_children_of(const string& name) override
+			{
+				vector<Person> result;
+				for_each_child_of(name, [&result](const Person& child) { result.push_back(child); });
+				return result;
+			}
+
+			size_t bucket_count() const { return table.load(memory_order_acquire)->buckets.size(); }
+		};
+
 		// analizing data is high-level
 		struct Research // high-level
 		{
@@ -382,7 +1437,223 @@ namespace Solid
 
 			Research research(relationships);
 
+			// the same research works with the store that can be shared between threads
+			ConcurrentRelationships shared_relationships;
+			shared_relationships.add_parent_and_child(parent, child1);
+			shared_relationships.add_parent_and_child(parent, child2);
+			Research shared_research(shared_relationships);
+
 			getchar();
 		}
+
+		// every query scans all the relations, so the cost grows with the number of families
+		void dependency_inversion_principle_benchmark(const size_t family_count = 10000, const unsigned seed = 42)
+		{
+			Relationships relationships;
+			for (size_t i = 0; i < family_count; i++)
+			{
+				const Person parent{ "parent " + to_string(i) };
+				relationships.add_parent_and_child(parent, Person{ "first child " + to_string(i) });
+				relationships.add_parent_and_child(parent, Person{ "second child " + to_string(i) });
+			}
+
+			mt19937 random{ seed };
+			uniform_int_distribution<size_t> family{ 0, family_count - 1 };
+			vector<string> queries(100);
+			for (auto& query : queries)
+				query = "parent " + to_string(family(random));
+
+			size_t found = 0;
+			Benchmark::report("Relationships::find_all_children_of", Benchmark::measure([&]
+			{
+				for (const auto& query : queries)
+					found += relationships.find_all_children_of(query).size();
+			}), queries.size());
+			Benchmark::do_not_optimize(found);
+		}
+
+		// readers and writers hammer the same parents at the same time and check what they see
+		// build it with -fsanitize=thread to let the thread sanitizer watch the accesses too
+		// returns false when something was wrong
+		bool concurrent_relationships_stress(const size_t parent_count = 1000, const size_t children_per_writer = 20000,
+			const unsigned writer_count = 2, const unsigned reader_count = 4)
+		{
+			// the smallest table, so the table also grows while the readers read
+			ConcurrentRelationships relationships{ 1 };
+			atomic<bool> writing{ true };
+			atomic<size_t> errors{ 0 };
+
+			vector<thread> threads;
+			for (unsigned w = 0; w < writer_count; w++)
+				threads.emplace_back([&, w]
+				{
+					for (size_t i = 0; i < children_per_writer; i++)
+						relationships.add_parent_and_child(Person{ "parent " + to_string(i % parent_count) },
+							Person{ "child " + to_string(w) + " " + to_string(i) });
+				});
+
+			for (unsigned r = 0; r < reader_count; r++)
+				threads.emplace_back([&, r]
+				{
+					// the children of a parent can only get more, never fewer
+					vector<size_t> seen(parent_count);
+					mt19937 random{ r };
+					while (writing.load(memory_order_relaxed))
+					{
+						const size_t parent = random() % parent_count;
+						size_t count = 0;
+						relationships.for_each_child_of("parent " + to_string(parent), [&](const Person& child)
+						{
+							count++;
+							if (child.name.compare(0, 6, "child ") != 0)
+								errors.fetch_add(1, memory_order_relaxed);
+						});
+						if (count < seen[parent])
+							errors.fetch_add(1, memory_order_relaxed);
+						seen[parent] = count;
+					}
+				});
+
+			for (unsigned w = 0; w < writer_count; w++)
+				threads[w].join();
+			writing.store(false, memory_order_relaxed);
+			for (size_t t = writer_count; t < threads.size(); t++)
+				threads[t].join();
+
+			// every child has to be there exactly once
+			size_t total = 0;
+			for (size_t parent = 0; parent < parent_count; parent++)
+				total += relationships.find_all_children_of("parent " + to_string(parent)).size();
+			if (total != writer_count * children_per_writer)
+				errors.fetch_add(1, memory_order_relaxed);
+
+			cout << "concurrent relationships stress: " << writer_count << " writers, " << reader_count << " readers, "
+				<< total << " children, " << relationships.bucket_count() << " buckets, " << errors.load() << " errors" << endl;
+			return errors.load() == 0;
+		}
+
+		// lookups mixed with additions on several threads, the lock-free store against a map behind a reader-writer lock
+		void concurrent_relationships_benchmark(const size_t family_count = 10000, const size_t operations_per_thread = 200000,
+			const unsigned seed = 42)
+		{
+			// what we would write without thinking twice
+			struct LockedRelationships
+			{
+				mutable shared_mutex lock;
+				unordered_map<string, vector<Person>> children;
+
+				void add_parent_and_child(const Person& parent, const Person& child)
+				{
+					unique_lock<shared_mutex> writer{ lock };
+					children[string{ parent.name }].push_back(child);
+				}
+
+				size_t count_children_of(const string& name) const
+				{
+					shared_lock<shared_mutex> reader{ lock };
+					const auto found = children.find(name);
+					return found == children.end() ? 0 : found->second.size();
+				}
+			};
+
+			const unsigned thread_count = max(4u, thread::hardware_concurrency());
+			vector<string> parents(family_count);
+			for (size_t i = 0; i < family_count; i++)
+				parents[i] = "parent " + to_string(i);
+
+			auto run = [&](auto& relationships, auto count_children, const unsigned read_percent)
+			{
+				vector<thread> threads;
+				atomic<size_t> found{ 0 };
+				for (unsigned t = 0; t < thread_count; t++)
+					threads.emplace_back([&, t]
+					{
+						mt19937 random{ seed + t };
+						const Person child{ "a child with a name too long for the small string buffer" };
+						size_t local = 0;
+						for (size_t i = 0; i < operations_per_thread; i++)
+						{
+							const string& parent = parents[random() % family_count];
+							if (random() % 100 < read_percent)
+								local += count_children(relationships, parent);
+							else
+								relationships.add_parent_and_child(Person{ parent }, child);
+						}
+						found.fetch_add(local, memory_order_relaxed);
+					});
+				for (auto& thread : threads)
+					thread.join();
+				Benchmark::do_not_optimize(found);
+			};
+
+			auto count_concurrent = [](const ConcurrentRelationships& r, const string& name)
+			{
+				size_t count = 0;
+				r.for_each_child_of(name, [&count](const Person&) { count++; });
+				return count;
+			};
+			auto count_locked = [](const LockedRelationships& r, const string& name) { return r.count_children_of(name); };
+
+			for (const unsigned read_percent : { 95u, 50u })
+			{
+				const string mix = to_string(read_percent) + "/" + to_string(100 - read_percent) + " read/write, "
+					+ to_string(thread_count) + " threads";
+
+				Benchmark::report("LockedRelationships, " + mix, Benchmark::measure([&]
+				{
+					LockedRelationships relationships;
+					for (const auto& parent : parents)
+						relationships.add_parent_and_child(Person{ parent }, Person{ "first child" });
+					run(relationships, count_locked, read_percent);
+				}, 3), thread_count * operations_per_thread);
+
+				Benchmark::report("ConcurrentRelationships, " + mix, Benchmark::measure([&]
+				{
+					ConcurrentRelationships relationships{ family_count };
+					for (const auto& parent : parents)
+						relationships.add_parent_and_child(Person{ parent }, Person{ "first child" });
+					run(relationships, count_concurrent, read_percent);
+				}, 3), thread_count * operations_per_thread);
+			}
+		}
+
+		// one "request" builds a family tree, asks about it and throws it away
+		void dependency_inversion_principle_memory_benchmark(const size_t family_count = 1000, const int request_count = 20)
+		{
+			auto request = [family_count](pmr::memory_resource* resource)
+			{
+				Relationships relationships{ resource };
+				for (size_t i = 0; i < family_count; i++)
+				{
+					const string parent = "parent with a long name " + to_string(i);
+					relationships.add_parent_and_child(Person{ parent }, Person{ "first child with a long name" });
+					relationships.add_parent_and_child(Person{ parent }, Person{ "second child with a long name" });
+				}
+
+				size_t found = 0;
+				for (size_t i = 0; i < family_count; i += 10)
+					found += relationships.find_all_children_of("parent with a long name " + to_string(i), resource).size();
+				Benchmark::do_not_optimize(found);
+			};
+
+			CountingResource heap;
+			Benchmark::report("relationships, global heap", Benchmark::measure([&]
+			{
+				for (int i = 0; i < request_count; i++)
+					request(&heap);
+			}), request_count);
+			heap.get_statistics().print("global heap");
+
+			ArenaResource arena;
+			Benchmark::report("relationships, arena", Benchmark::measure([&]
+			{
+				for (int i = 0; i < request_count; i++)
+				{
+					request(&arena);
+					arena.release();
+				}
+			}), request_count);
+			arena.get_statistics().print("arena");
+		}
 	};
 }
\ No newline at end of file
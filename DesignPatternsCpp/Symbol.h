@@ -0,0 +1,58 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// === interned strings ===
+// a document has thousands of elements but only a handful of distinct tag names (p, img, li...)
+// and attribute keys (src, href...), storing every one of them as its own std::string wastes memory
+// a Symbol is a pointer to the only copy of the text kept in a process-wide table
+//	- it is as big as a pointer (std::string is 32 bytes) and never allocates once the text is known
+//	- two symbols are equal when the pointers are equal, no characters are compared
+// the empty text is not in the table, so a default Symbol costs neither a lock nor a lookup
+// the table only grows, interned texts live until the end of the program - fine for names, not for user data
+class Symbol
+{
+	const std::string* text;
+
+	// the texts live in a deque, which never moves its elements when it grows, so the pointers stay valid
+	// the map is keyed by views of those texts, a lookup of a known text does not allocate anything
+	static const std::string* intern(const std::string_view value)
+	{
+		static const std::string empty;
+		if (value.empty())
+			return &empty;
+
+		static std::mutex mutex;
+		static std::deque<std::string> texts;
+		static std::unordered_map<std::string_view, const std::string*> table;
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		const auto found = table.find(value);
+		if (found != table.end())
+			return found->second;
+
+		const std::string* text = &texts.emplace_back(value);
+		table.emplace(*text, text);
+		return text;
+	}
+
+public:
+	Symbol() : Symbol{ std::string_view{} } { }
+	Symbol(const std::string_view value) : text{ intern(value) } { }
+	Symbol(const std::string& value) : Symbol{ std::string_view{ value } } { }
+	Symbol(const char* value) : Symbol{ std::string_view{ value } } { }
+
+	std::string_view view() const { return *text; }
+	const std::string& str() const { return *text; }
+	size_t size() const { return text->size(); }
+	bool empty() const { return text->empty(); }
+
+	friend bool operator==(const Symbol a, const Symbol b) { return a.text == b.text; }
+	friend bool operator!=(const Symbol a, const Symbol b) { return a.text != b.text; }
+
+	friend std::ostream& operator<<(std::ostream& os, const Symbol symbol) { return os << *symbol.text; }
+};